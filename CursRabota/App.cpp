@@ -1,14 +1,16 @@
 //--------------------------------------------------------------------------------------------------
 /**
-	   App.cpp
+	файл   App.cpp
 **/
 //--------------------------------------------------------------------------------------------------
 
 #include "App.h"
-//      
-#include "Debug.h" //  
-#include "Game.h" //   
-#include "Renderer.h" //  
+// подключаем все заголовочные файлы проекта 
+#include "Debug.h" //класс дебага 
+#include "Game.h" // класс игры 
+#include "LatencyHistogram.h" // задержка от нажатия до кадра
+#include "Profiler.h" // замеры времени кадра
+#include "Renderer.h" //класс рендера 
 
 #include "SDL.h" //SDL 2
 #include "SDL_ttf.h" //SDL_ttf2
@@ -18,7 +20,16 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 #include <chrono>
+#include <thread>
+
+static const Uint32 s_kIdleWaitTimeoutMs = 500;		// в режиме ожидания всё равно просыпаемся хотя бы раз в полсекунды
+static const long long s_kSpinMicroseconds = 2000;	// последние 2 мс до кадра крутимся, SDL_Delay так точно не умеет
+static const long long s_kLowLatencyMarginMicroseconds = 2000;	// запас к оценке работы кадра, чтобы не пропустить vsync
+static const int s_kDefaultRefreshRate = 60;	// если SDL не знает частоту дисплея
+static const int s_kEventThreadWaitMs = 100;	// как часто поток событий проверяет, не закончилась ли игра
+static const unsigned int s_kRenderThreadWaitMs = 100;	// так же часто поток отрисовки без новых снимков
 
 //--------------------------------------------------------------------------------------------------
 
@@ -58,18 +69,72 @@ static void PrintGLString(GLenum name)
 
 #endif // GL_ES_VERSION_2_0
 
+// грубо спим через SDL_Delay, остаток докручиваем
+static void WaitUntil(const std::chrono::high_resolution_clock::time_point& time)
+{
+	const long long microsecondsLeft = std::chrono::duration_cast<std::chrono::microseconds>(time - std::chrono::high_resolution_clock::now()).count();
+	if (microsecondsLeft > s_kSpinMicroseconds)
+	{
+		SDL_Delay((Uint32)((microsecondsLeft - s_kSpinMicroseconds) / 1000));
+	}
+	while (std::chrono::high_resolution_clock::now() < time)
+	{
+	}
+}
+
+// ввод кадра копится из нескольких событий; зажатие - по последнему
+static void MergeGameInput(const GameInput& src, GameInput& dst)
+{
+	dst.bStart = dst.bStart || src.bStart;
+	dst.bMoveLeft = dst.bMoveLeft || src.bMoveLeft;
+	dst.bMoveRight = dst.bMoveRight || src.bMoveRight;
+	dst.bRotateClockwise = dst.bRotateClockwise || src.bRotateClockwise;
+	dst.bRotateAnticlockwise = dst.bRotateAnticlockwise || src.bRotateAnticlockwise;
+	dst.bHardDrop = dst.bHardDrop || src.bHardDrop;
+	dst.bSoftDrop = dst.bSoftDrop || src.bSoftDrop;
+	dst.bPause = dst.bPause || src.bPause;
+	dst.WatchHighScore = dst.WatchHighScore || src.WatchHighScore;
+	dst.Rules = dst.Rules || src.Rules;
+	dst.bToggleGhost = dst.bToggleGhost || src.bToggleGhost;
+	dst.bHoldLeft = src.bHoldLeft;
+	dst.bHoldRight = src.bHoldRight;
+#ifdef _DEBUG
+	dst.bDebugChangeTetromino = dst.bDebugChangeTetromino || src.bDebugChangeTetromino;
+	dst.bDebugMoveLeft = dst.bDebugMoveLeft || src.bDebugMoveLeft;
+	dst.bDebugMoveRight = dst.bDebugMoveRight || src.bDebugMoveRight;
+	dst.bDebugMoveUp = dst.bDebugMoveUp || src.bDebugMoveUp;
+	dst.bDebugMoveDown = dst.bDebugMoveDown || src.bDebugMoveDown;
+#endif
+}
+
 //--------------------------------------------------------------------------------------------------
 
 App::App()
 	: m_pWindow(nullptr)
 	, m_pRenderer(nullptr)
 	, m_pGame(nullptr)
+	, m_pProfiler(nullptr)
+	, m_bShowProfiler(false)
+	, m_pLatencyHistogram(nullptr)
+	, m_numPendingInputs(0)
+	, m_numDroppedInputs(0)
+	, m_pInputQueue(nullptr)
+	, m_bGameLoopDone(false)
+	, m_numDroppedInputRecords(0)
+	, m_pSnapshotBuffer(nullptr)
+	, m_bSnapshotDropped(false)
+	, m_bRenderTargetsLost(false)
+	, m_simulationInputNanoseconds(0)
+	, m_simulationUpdateNanoseconds(0)
 {
+	memset(&m_options, 0, sizeof(m_options));
 
 }
-//   ,  false,      SDL_INIT_EVERYTHING
-bool App::Init(bool bFullScreen, unsigned int displayWidth, unsigned int displayHeight)
+// булевая функция инициализации, возврат false, если не получилось выполнить функцию SDL_INIT_EVERYTHING
+bool App::Init(const AppOptions& options)
 {
+	m_options = options;
+
 	if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
 	{
 		fprintf(stderr, "SDL failed to initialise: %s\n", SDL_GetError());
@@ -86,11 +151,11 @@ bool App::Init(bool bFullScreen, unsigned int displayWidth, unsigned int display
 	print_SDL_version("Linking against SDL version", linkedVersion);
 	SDL_assert_release((compiledVersion == linkedVersion));
 
-	int numDisplays = SDL_GetNumVideoDisplays(); //   
+	int numDisplays = SDL_GetNumVideoDisplays(); // количество доступных видеодисплеев
 	printf("%d video displays\n", numDisplays);
 	for (int i = 0; i < numDisplays; ++i)
 	{
-		SDL_DisplayMode displayMode; //        
+		SDL_DisplayMode displayMode; // переменная для записи информации о данном дисплее 
 		if (SDL_GetCurrentDisplayMode(i, &displayMode) != 0)
 		{
 			fprintf(stderr, "Failed to get display mode for video display %d: %s", i, SDL_GetError());
@@ -107,15 +172,15 @@ bool App::Init(bool bFullScreen, unsigned int displayWidth, unsigned int display
 #endif
 
 	const char* title = "SDL Kursach";
-	//    -  ,    
-	if (bFullScreen)
+	//если удалось создать окно - то созадем, иначе выводим ошибку 
+	if (options.bFullScreen)
 	{
 		HP_FATAL_ERROR("Just checking");
 		m_pWindow = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 0, 0, SDL_WINDOW_FULLSCREEN_DESKTOP);
 	}
 	else
 	{
-		m_pWindow = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, displayWidth, displayHeight, SDL_WINDOW_SHOWN /*| SDL_WINDOW_OPENGL*/);
+		m_pWindow = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, options.displayWidth, options.displayHeight, SDL_WINDOW_SHOWN /*| SDL_WINDOW_OPENGL*/);
 	}
 
 	if (!m_pWindow)
@@ -139,7 +204,7 @@ bool App::Init(bool bFullScreen, unsigned int displayWidth, unsigned int display
 #endif
 
 	// SDL2_ttf
-	//   SDL_ttf
+	//проверяем подключенность библиотеки SDL_ttf
 	if (TTF_Init() == -1)
 	{
 		fprintf(stderr, "Failed to initialise SDL2_ttf: %s\n", TTF_GetError());
@@ -152,22 +217,61 @@ bool App::Init(bool bFullScreen, unsigned int displayWidth, unsigned int display
 	const SDL_version *pLinkedVersion = TTF_Linked_Version();
 	print_SDL_version("Compiled against SDL_ttf version", compiledVersion);
 	print_SDL_version("Linking against SDL_ttf version", *pLinkedVersion);
-	//    (1280 * 720) 
-	unsigned int logicalWidth = 1280;
-	unsigned int logicalHeight = 720;
-	m_pRenderer = new Renderer(*m_pWindow, logicalWidth, logicalHeight); //     
+	m_pProfiler = new Profiler();
+	m_pLatencyHistogram = new LatencyHistogram();
 
-	m_pGame = new Game(); //     
+	// в многопоточных режимах рендерер создаст и будет использовать только поток, который рисует
+	if (options.bInputThread)
+	{
+		m_pInputQueue = new InputQueue();
+		m_timedInputs.reserve(InputQueue::kCapacity);
+	}
+	if (options.bRenderThread)
+	{
+		m_pSnapshotBuffer = new GameSnapshotBuffer();
+	}
+	if (!options.bInputThread && !options.bRenderThread)
+	{
+		CreateRenderer();
+	}
+
+	m_pGame = new Game(); // создаем элемент класса Игра 
 
-	if (!m_pGame->Init()) //    ,    
+	AutoPlayer::Settings autoplaySettings = AutoPlayer::GetDefaultSettings();
+	autoplaySettings.searchDepth = options.aiSearchDepth;
+	autoplaySettings.beamWidth = options.aiBeamWidth;
+	autoplaySettings.transpositionTableBytes = (size_t)options.aiTableMegabytes << 20;
+	autoplaySettings.numThreads = 0;	// перебор на всех ядрах, игра ждёт его в такте
+	if (!m_pGame->Init(options.seed, options.pRecordPath, options.bAutoplay ? &autoplaySettings : nullptr)) //если не получилось инициализировать , то выдаем ошибку 
 	{
 		fprintf(stderr, "ERROR - Game failed to initialise\n");
 		return false;
 	}
+	m_pGame->SetAutoShift(options.autoShiftDelayMs, options.autoRepeatMs);
+	printf("Auto shift: delay %u ms, repeat %u ms\n", m_pGame->GetAutoShiftDelayMs(), m_pGame->GetAutoRepeatMs());	// уже урезанные симуляцией
+
+	if (!Simulation::IsValidFieldSize(options.fieldSize))
+	{
+		fprintf(stderr, "ERROR - Invalid field size %ux%u+%u\n", options.fieldSize.width, options.fieldSize.height,
+			options.fieldSize.numHiddenRows);
+		return false;
+	}
+	m_pGame->SetFieldSize(options.fieldSize);
+	printf("Field: %ux%u, hidden rows %u\n", options.fieldSize.width, options.fieldSize.height, options.fieldSize.numHiddenRows);
 
 	return true;
 }
-//    
+// рендерер живёт в потоке, который в него рисует
+void App::CreateRenderer()
+{
+	// значение для окна (1280 * 720) 
+	unsigned int logicalWidth = 1280;
+	unsigned int logicalHeight = 720;
+	m_pRenderer = new Renderer(*m_pWindow, logicalWidth, logicalHeight, m_options.bVsync); // рендерим окно данного размера 
+	m_pRenderer->SetProfiler(m_pProfiler);
+	m_pRenderer->SetSyncAfterPresent(m_options.bLowLatency);
+}
+// метод закрывания игры 
 void App::ShutDown()  
 {
 	if (m_pGame)
@@ -180,101 +284,578 @@ void App::ShutDown()
 	delete m_pRenderer;
 	m_pRenderer = nullptr;
 
+	if (m_pProfiler && m_options.pProfileCsvPath)
+	{
+		m_pProfiler->WriteCsv(m_options.pProfileCsvPath);
+	}
+	delete m_pProfiler;
+	m_pProfiler = nullptr;
+
+	if (m_pLatencyHistogram)
+	{
+		m_pLatencyHistogram->Print();
+		if (m_numDroppedInputs > 0)
+		{
+			printf("Input latency: %u inputs dropped\n", m_numDroppedInputs);
+		}
+	}
+	delete m_pLatencyHistogram;
+	m_pLatencyHistogram = nullptr;
+
+	if (m_numDroppedInputRecords > 0)
+	{
+		printf("Input thread: %u events dropped, queue was full\n", m_numDroppedInputRecords);
+	}
+	delete m_pInputQueue;
+	m_pInputQueue = nullptr;
+	delete m_pSnapshotBuffer;
+	m_pSnapshotBuffer = nullptr;
+
+	HP_TRACE_WRITE(m_options.pTracePath ? m_options.pTracePath : "trace.json");
+
 	TTF_Quit();	// SDL2_TTF
 
-	SDL_DestroyWindow(m_pWindow); //   
-	SDL_Quit(); //   SDL2
+	SDL_DestroyWindow(m_pWindow); // уничтожаем окно 
+	SDL_Quit(); // выодим из SDL2
 }
-//    
-void App::Run()
+// одно событие SDL -> запись ввода; состояние приложения не меняет, поэтому годится для потока событий
+bool App::HandleEvent(const SDL_Event& event, InputRecord& record) const
 {
-	Uint32 lastTimeMs = SDL_GetTicks();	//   , SDL_GetTricks -        SDL.
-	auto lastTime = std::chrono::high_resolution_clock::now();	//  
+	memset(&record, 0, sizeof(record));
+	record.timeMicroseconds = InputQueue::GetTimeMicroseconds();
 
-	bool bDone = false;
-	while (!bDone)
+	// зажатые стрелки берём из состояния клавиатуры, оно обновлено вместе с событием
+	const Uint8* pKeyboardState = SDL_GetKeyboardState(nullptr);
+	GameInput& gameInput = record.gameInput;
+	gameInput.bHoldLeft = pKeyboardState[SDL_SCANCODE_LEFT] != 0;
+	gameInput.bHoldRight = pKeyboardState[SDL_SCANCODE_RIGHT] != 0;
+
+	if (event.type == SDL_QUIT)
 	{
-		GameInput gameInput = {};
+		record.bQuit = true;
+		return true;
+	}
+
+	// содержимое текстур-целей потеряно (например, при сбросе устройства D3D)
+	if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET)
+	{
+		record.bRenderTargetsReset = true;
+		return true;
+	}
+
+	// отпускание меняет только зажатие, события окна нужны для перерисовки статичного экрана
+	if (event.type == SDL_KEYUP || event.type == SDL_WINDOWEVENT)
+		return true;
+
+	// считываем все символы 
+	if (event.type == SDL_KEYDOWN)
+	{
+		// автоповтор клавиши не новое нажатие
+		if (!event.key.repeat)
+		{
+			record.eventTimestampMs = event.key.timestamp;
+		}
+
+		if (event.key.keysym.sym == SDLK_ESCAPE)
+		{
+			record.bQuit = true;
+		}
+		else if (event.key.keysym.sym == SDLK_F1)
+		{
+			record.bToggleProfiler = true;
+		}
+		else if (event.key.keysym.sym == SDLK_SPACE)
+		{
+			gameInput.bStart = true;
+		}
+		else if (event.key.keysym.sym == SDLK_LEFT)
+		{
+			// автоповтор системы не нужен: удержание стрелок обрабатывает автосдвиг симуляции
+			gameInput.bMoveLeft = gameInput.bMoveLeft || !event.key.repeat;
+		}
+		else if (event.key.keysym.sym == SDLK_RIGHT)
+		{
+			gameInput.bMoveRight = gameInput.bMoveRight || !event.key.repeat;
+		}
+		else if (event.key.keysym.sym == SDLK_z)
+		{
+			gameInput.bRotateClockwise = true;
+		}
+		else if (event.key.keysym.sym == SDLK_x)
+		{
+			gameInput.bRotateAnticlockwise = true;
+		}
+		else if (event.key.keysym.sym == SDLK_UP)
+		{
+			gameInput.bHardDrop = true;
+		}
+		else if (event.key.keysym.sym == SDLK_DOWN)
+		{
+			gameInput.bSoftDrop = true;
+		}
+		else if (event.key.keysym.sym == SDLK_p)
+		{
+			gameInput.bPause = true;
+		}
+		else if (event.key.keysym.sym == SDLK_h)
+		{
+			gameInput.WatchHighScore = true;
+		}
+		else if (event.key.keysym.sym == SDLK_r)
+		{
+			gameInput.Rules = true;
+		}
+		else if (event.key.keysym.sym == SDLK_g)
+		{
+			gameInput.bToggleGhost = true;
+		}
+#ifdef _DEGBUG
+		else if (event.key.keysym.sym == SDLK_t)
+		{
+			gameInput.bDebugChangeTetromino = true;
+		}
+		else if (event.key.keysym.sym == SDLK_a)
+		{
+			gameInput.bDebugMoveLeft = true;
+		}
+		else if (event.key.keysym.sym == SDLK_d)
+		{
+			gameInput.bDebugMoveRight = true;
+		}
+		else if (event.key.keysym.sym == SDLK_w)
+		{
+			gameInput.bDebugMoveUp = true;
+		}
+		else if (event.key.keysym.sym == SDLK_s)
+		{
+			gameInput.bDebugMoveDown = true;
+		}
+#endif
+		return true;
+	}
+	return false;
+}
+// запись ввода -> ввод кадра и команды приложения, в потоке игры
+void App::ApplyInput(const InputRecord& record, GameInput& gameInput, bool& bDone)
+{
+	bDone = bDone || record.bQuit;
+	if (record.bToggleProfiler)
+	{
+		m_bShowProfiler.store(!m_bShowProfiler.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+	if (record.bRenderTargetsReset)
+	{
+		if (m_pSnapshotBuffer)
+		{
+			m_bRenderTargetsLost.store(true, std::memory_order_release);
+		}
+		else
+		{
+			m_pRenderer->OnRenderTargetsReset();
+		}
+	}
+	if (record.eventTimestampMs != 0)
+	{
+		if (m_numPendingInputs < kMaxPendingInputs)
+		{
+			m_pendingInputTimestamps[m_numPendingInputs++] = record.eventTimestampMs;
+		}
+		else
+		{
+			++m_numDroppedInputs;
+		}
+	}
+	MergeGameInput(record.gameInput, gameInput);
+}
+// min/avg/p99/max по этапам за последние кадры, поверх игры
+void App::DrawProfilerOverlay()
+{
+	Profiler::StageStats stats[kNumProfileStages];
+	m_pProfiler->ComputeStats(stats);
+
+	const int lineHeight = 34;
+	const int x = (int)m_pRenderer->GetLogicalWidth() - 620;
+	int y = (int)m_pRenderer->GetLogicalHeight() - (kNumProfileStages + 3) * lineHeight;
+	m_pRenderer->DrawSolidRect(x - 8, y - 4, 628, (kNumProfileStages + 3) * lineHeight + 4, 0x000000ff);
+
+	char text[128];
+	snprintf(text, sizeof(text), "%u кадров, мс", m_pProfiler->GetNumFrames());
+	m_pRenderer->DrawDynamicText(text, x, y, 0xffff80ff);
+	y += lineHeight;
+	m_pRenderer->DrawDynamicText("           min   avg   p99   max", x, y, 0xffff80ff);
+	y += lineHeight;
+	for (unsigned int stage = 0; stage < kNumProfileStages; ++stage)
+	{
+		const Profiler::StageStats& stageStats = stats[stage];
+		snprintf(text, sizeof(text), "%-9s%5.2f %5.2f %5.2f %5.2f", Profiler::GetStageName((ProfileStage)stage),
+			stageStats.minMs, stageStats.avgMs, stageStats.p99Ms, stageStats.maxMs);
+		m_pRenderer->DrawDynamicText(text, x, y, 0xffffffff);
+		y += lineHeight;
+	}
 
-		//    
+	// от нажатия до возврата из Present, точность мс
+	snprintf(text, sizeof(text), "%-9s%5u %5.1f %5u %5u", "Ввод", m_pLatencyHistogram->GetPercentileMs(0.0f),
+		m_pLatencyHistogram->GetAverageMs(), m_pLatencyHistogram->GetPercentileMs(99.0f), m_pLatencyHistogram->GetMaxMs());
+	m_pRenderer->DrawDynamicText(text, x, y, 0xffff80ff);
+}
+// нажатия, обработанные до этого кадра, теперь на экране
+void App::OnFramePresented(const unsigned int* pInputTimestampsMs, unsigned int numInputTimestamps)
+{
+	const Uint32 presentTimeMs = SDL_GetTicks();	// метки событий SDL тоже в мс от SDL_Init
+	for (unsigned int i = 0; i < numInputTimestamps; ++i)
+	{
+		m_pLatencyHistogram->Add(presentTimeMs - pInputTimestampsMs[i]);
+	}
+}
+// ввод без ожидания: из очереди потока событий или прямо из SDL
+bool App::PollInput(GameInput& gameInput, bool& bDone)
+{
+	bool bHadEvents = false;
+	InputRecord record;
+	if (m_pInputQueue)
+	{
+		m_timedInputs.clear();
+		while (m_pInputQueue->Pop(record))
+		{
+			ApplyInput(record, gameInput, bDone);
+			m_timedInputs.push_back(record);
+			bHadEvents = true;
+		}
+	}
+	else
+	{
 		SDL_Event event;
 		while (SDL_PollEvent(&event))
 		{
-			if (event.type == SDL_QUIT)
+			if (HandleEvent(event, record))
 			{
-				bDone = true;
+				ApplyInput(record, gameInput, bDone);
 			}
+			bHadEvents = true;
+		}
+
+		// зажатые стрелки берём из состояния клавиатуры, оно обновлено последним SDL_PollEvent
+		const Uint8* pKeyboardState = SDL_GetKeyboardState(nullptr);
+		gameInput.bHoldLeft = pKeyboardState[SDL_SCANCODE_LEFT] != 0;
+		gameInput.bHoldRight = pKeyboardState[SDL_SCANCODE_RIGHT] != 0;
+	}
+	return bHadEvents;
+}
+// на экране ничего не меняется - спим до события, но не дольше s_kIdleWaitTimeoutMs
+bool App::WaitForInput(GameInput& gameInput, bool& bDone)
+{
+	HP_TRACE_SCOPE("App::WaitForInput");
+	if (m_pInputQueue)
+	{
+		m_pInputQueue->WaitForRecords(s_kIdleWaitTimeoutMs);	// будит поток событий после Push, записи заберёт PollInput
+		return false;
+	}
+
+	SDL_Event event;
+	if (!SDL_WaitEventTimeout(&event, s_kIdleWaitTimeoutMs))
+		return false;
+
+	InputRecord record;
+	if (HandleEvent(event, record))
+	{
+		ApplyInput(record, gameInput, bDone);
+	}
+	return true;
+}
+// снимок для потока отрисовки; нажатия не нарисованного снимка переносятся в этот
+void App::PublishSnapshot()
+{
+	GameSnapshot& snapshot = m_pSnapshotBuffer->GetWriteSnapshot();
+	if (!m_bSnapshotDropped)
+	{
+		snapshot.numInputTimestamps = 0;
+	}
+	for (unsigned int i = 0; i < m_numPendingInputs; ++i)
+	{
+		if (snapshot.numInputTimestamps < GameSnapshot::kMaxInputTimestamps)
+		{
+			snapshot.inputTimestampsMs[snapshot.numInputTimestamps++] = m_pendingInputTimestamps[i];
+		}
+		else
+		{
+			++m_numDroppedInputs;
+		}
+	}
+	m_numPendingInputs = 0;
+
+	m_pGame->WriteSnapshot(snapshot);
+	m_bSnapshotDropped = m_pSnapshotBuffer->Publish();
+}
+// метод запуска игры 
+void App::Run()
+{
+	HP_TRACE_THREAD_NAME("Main");
+	HP_TRACE_SCOPE("App::Run");
 
-			//    
-			if (event.type == SDL_KEYDOWN)
+	if (!m_pInputQueue && !m_pSnapshotBuffer)
+	{
+		RunGameLoop();
+		return;
+	}
+
+	m_bGameLoopDone = false;
+
+	// поток отрисовки работает, пока не закончится цикл игры
+	std::thread renderThread;
+	if (m_pSnapshotBuffer)
+	{
+		renderThread = std::thread([this]()
+		{
+			HP_TRACE_THREAD_NAME("Render");
+			CreateRenderer();
+			RunRenderLoop();
+			delete m_pRenderer;
+			m_pRenderer = nullptr;
+		});
+	}
+
+	auto gameLoop = [this]()
+	{
+		if (m_pSnapshotBuffer)
+		{
+			RunSimulationLoop();
+		}
+		else
+		{
+			CreateRenderer();
+			RunGameLoop();
+			delete m_pRenderer;
+			m_pRenderer = nullptr;
+		}
+		m_bGameLoopDone.store(true, std::memory_order_release);
+	};
+
+	if (m_pInputQueue)
+	{
+		// SDL принимает события только в потоке, создавшем окно, поэтому главный поток остаётся потоком событий,
+		// а игра уходит в свой поток. Vsync в Present больше не задерживает приём ввода
+		std::thread gameThread([&gameLoop]()
+		{
+			HP_TRACE_THREAD_NAME("Game");
+			gameLoop();
+		});
+		RunEventLoop();
+		gameThread.join();
+	}
+	else
+	{
+		gameLoop();
+	}
+
+	if (renderThread.joinable())
+	{
+		renderThread.join();
+	}
+}
+// поток игры при отрисовке в своём потоке: ввод и такты идут с частотой симуляции, кадр не ждём
+void App::RunSimulationLoop()
+{
+	HP_TRACE_SCOPE("App::RunSimulationLoop");
+
+	const std::chrono::microseconds tickDuration(1000000 / Simulation::kTicksPerSecond);
+	auto lastTime = std::chrono::high_resolution_clock::now();
+	auto nextTickTime = lastTime + tickDuration;
+
+	bool bPublish = true;	// первый снимок публикуем всегда
+	bool bDone = false;
+	while (!bDone)
+	{
+		HP_TRACE_SCOPE("SimulationFrame");
+
+		GameInput gameInput = {};
+		bool bHadEvents = false;
+		if (m_options.bIdle && !bPublish && m_pGame->IsStatic())
+		{
+			bHadEvents = WaitForInput(gameInput, bDone);
+		}
+
+		const Profiler::Clock::time_point inputStartTime = Profiler::Clock::now();
+		bHadEvents = PollInput(gameInput, bDone) || bHadEvents;
+
+		auto currentTime = std::chrono::high_resolution_clock::now();
+		m_simulationInputNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(currentTime - inputStartTime).count(),
+			std::memory_order_relaxed);
+		const float deltaTimeSeconds = 0.000001f * (float)std::chrono::duration_cast<std::chrono::microseconds>(currentTime - lastTime).count();
+		lastTime = currentTime;
+
+		if (m_pInputQueue)
+		{
+			const long long frameTimeMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(currentTime.time_since_epoch()).count();
+			m_pGame->UpdateTimed(gameInput, m_timedInputs.data(), (unsigned int)m_timedInputs.size(), frameTimeMicroseconds, deltaTimeSeconds);
+		}
+		else
+		{
+			m_pGame->Update(gameInput, deltaTimeSeconds);
+		}
+		m_simulationUpdateNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(Profiler::Clock::now() - currentTime).count(),
+			std::memory_order_relaxed);
+
+		// статичный экран публикуем только после событий, как и перерисовку в обычном режиме
+		bPublish = bPublish || bHadEvents || !m_options.bIdle || !m_pGame->IsStatic();
+		if (bPublish)
+		{
+			PublishSnapshot();
+			bPublish = false;
+		}
+
+		auto now = std::chrono::high_resolution_clock::now();
+		if (m_options.bIdle && m_pGame->IsStatic())
+		{
+			// такты не нужны: следующая итерация спит в WaitForInput, WaitUntil крутился бы впустую
+			nextTickTime = now + tickDuration;
+			continue;
+		}
+		if (now > nextTickTime + tickDuration)
+		{
+			nextTickTime = now;	// сильно отстали - не догоняем
+		}
+		WaitUntil(nextTickTime);
+		nextTickTime += tickDuration;
+	}
+}
+// поток отрисовки: рисует последний опубликованный снимок, vsync в Present задерживает только этот поток
+void App::RunRenderLoop()
+{
+	HP_TRACE_SCOPE("App::RunRenderLoop");
+
+	auto lastTime = std::chrono::high_resolution_clock::now();
+	while (!m_bGameLoopDone.load(std::memory_order_acquire))
+	{
+		if (m_bRenderTargetsLost.exchange(false, std::memory_order_acquire))
+		{
+			m_pRenderer->OnRenderTargetsReset();
+		}
+
+		if (!m_pSnapshotBuffer->Acquire())
+		{
+			// игра не опубликовала ничего нового - картинка на экране актуальна, спим до PublishSnapshot
+			m_pSnapshotBuffer->WaitForPublish(s_kRenderThreadWaitMs);
+			continue;
+		}
+		HP_TRACE_SCOPE("RenderFrame");
+		const GameSnapshot& snapshot = m_pSnapshotBuffer->GetReadSnapshot();
+
+		auto currentTime = std::chrono::high_resolution_clock::now();
+		const float frameSeconds = 0.000001f * (float)std::chrono::duration_cast<std::chrono::microseconds>(currentTime - lastTime).count();
+		lastTime = currentTime;
+
+		m_pProfiler->BeginFrame();
+		// ввод и такты идут в потоке игры: в кадр попадает их время с прошлого кадра
+		m_pProfiler->AddTime(kProfileStage_Input, std::chrono::duration_cast<Profiler::Clock::duration>(
+			std::chrono::nanoseconds(m_simulationInputNanoseconds.exchange(0, std::memory_order_relaxed))));
+		m_pProfiler->AddTime(kProfileStage_Update, std::chrono::duration_cast<Profiler::Clock::duration>(
+			std::chrono::nanoseconds(m_simulationUpdateNanoseconds.exchange(0, std::memory_order_relaxed))));
+		m_pRenderer->Clear();
+		{
+			ProfileScope profileScope(m_pProfiler, kProfileStage_Draw);
+			m_pGame->Draw(*m_pRenderer, snapshot, frameSeconds);
+		}
+		if (m_bShowProfiler.load(std::memory_order_relaxed))
+		{
+			DrawProfilerOverlay();
+		}
+		m_pRenderer->Present();
+		OnFramePresented(snapshot.inputTimestampsMs, snapshot.numInputTimestamps);
+		m_pProfiler->EndFrame();
+	}
+}
+// поток событий: каждое событие сразу с моментом получения в очередь, игра разложит их по тактам
+void App::RunEventLoop()
+{
+	HP_TRACE_SCOPE("App::RunEventLoop");
+	while (!m_bGameLoopDone.load(std::memory_order_acquire))
+	{
+		SDL_Event event;
+		if (!SDL_WaitEventTimeout(&event, s_kEventThreadWaitMs))
+			continue;
+
+		bool bPushed = false;
+		do
+		{
+			InputRecord record;
+			if (HandleEvent(event, record))
 			{
-				if (event.key.keysym.sym == SDLK_ESCAPE)
-				{
-					bDone = true;
-				}
-				else if (event.key.keysym.sym == SDLK_SPACE)
-				{
-					gameInput.bStart = true;
-				}
-				else if (event.key.keysym.sym == SDLK_LEFT)
-				{
-					gameInput.bMoveLeft = true;
-				}
-				else if (event.key.keysym.sym == SDLK_RIGHT)
-				{
-					gameInput.bMoveRight = true;
-				}
-				else if (event.key.keysym.sym == SDLK_z)
-				{
-					gameInput.bRotateClockwise = true;
-				}
-				else if (event.key.keysym.sym == SDLK_x)
-				{
-					gameInput.bRotateAnticlockwise = true;
-				}
-				else if (event.key.keysym.sym == SDLK_UP)
-				{
-					gameInput.bHardDrop = true;
-				}
-				else if (event.key.keysym.sym == SDLK_DOWN)
+				if (m_pInputQueue->Push(record))
 				{
-					gameInput.bSoftDrop = true;
+					bPushed = true;
 				}
-				else if (event.key.keysym.sym == SDLK_p)
+				else
 				{
-					gameInput.bPause = true;
+					++m_numDroppedInputRecords;
 				}
-				else if (event.key.keysym.sym == SDLK_h)
-				{
-					gameInput.WatchHighScore = true;
-				}
-				else if (event.key.keysym.sym == SDLK_r)
-				{
-					gameInput.Rules = true;
-				}
-#ifdef _DEGBUG
-				else if (event.key.keysym.sym == SDLK_t)
-				{
-					gameInput.bDebugChangeTetromino = true;
-				}
-				else if (event.key.keysym.sym == SDLK_a)
-				{
-					gameInput.bDebugMoveLeft = true;
-				}
-				else if (event.key.keysym.sym == SDLK_d)
-				{
-					gameInput.bDebugMoveRight = true;
-				}
-				else if (event.key.keysym.sym == SDLK_w)
-				{
-					gameInput.bDebugMoveUp = true;
-				}
-				else if (event.key.keysym.sym == SDLK_s)
-				{
-					gameInput.bDebugMoveDown = true;
-				}
-#endif
 			}
+		} while (SDL_PollEvent(&event));
+
+		if (bPushed)
+		{
+			m_pInputQueue->WakeReader();	// поток игры может спать на статичном экране
+		}
+	}
+}
+// цикл кадров: ввод, обновление, отрисовка
+void App::RunGameLoop()
+{
+	HP_TRACE_SCOPE("App::RunGameLoop");
+
+	Uint32 lastTimeMs = SDL_GetTicks();	// только точность мс, SDL_GetTricks - Получите количество миллисекунд с момента инициализации библиотеки SDL.
+	auto lastTime = std::chrono::high_resolution_clock::now();	// высокоточное время
+
+	const std::chrono::microseconds frameDuration(m_options.fpsCap > 0 ? 1000000 / m_options.fpsCap : 0);
+	auto nextFrameTime = lastTime + frameDuration;
+
+	// режим малой задержки: после Present ждём, пока до следующего vsync не останется как раз на работу кадра,
+	// и только тогда опрашиваем ввод. Работу кадра оцениваем по худшему из последних kNumWorkTimes кадров
+	const bool bLowLatencyWait = m_options.bLowLatency && m_options.bVsync;
+	std::chrono::microseconds refreshPeriod(1000000 / s_kDefaultRefreshRate);
+	if (m_options.bLowLatency)
+	{
+		SDL_DisplayMode displayMode;
+		if (SDL_GetWindowDisplayMode(m_pWindow, &displayMode) == 0 && displayMode.refresh_rate > 0)
+		{
+			refreshPeriod = std::chrono::microseconds(1000000 / displayMode.refresh_rate);
+		}
+		printf("Low latency mode: vsync=%d refresh period=%lld us\n", m_options.bVsync, (long long)refreshPeriod.count());
+	}
+	long long workTimes[kNumWorkTimes] = {};	// мкс от опроса ввода до Present
+	unsigned int workTimeIndex = 0;
+	bool bHasLastPresent = false;
+	auto lastPresentTime = lastTime;
+
+	bool bRedraw = true;	// первый кадр рисуем всегда
+	bool bDone = false;
+	while (!bDone)
+	{
+		HP_TRACE_SCOPE("Frame");
+
+		GameInput gameInput = {};
+
+		// СЧИТЫВАЕМ ДЕЙСТВИЯ ПОЛЬЗОВАТЕЛЯ 
+		bool bHadEvents = false;
+		if (m_options.bIdle && !bRedraw && m_pGame->IsStatic())
+		{
+			bHadEvents = WaitForInput(gameInput, bDone);
+		}
+		if (bLowLatencyWait && bHasLastPresent && !bHadEvents)
+		{
+			HP_TRACE_SCOPE("App::LowLatencyWait");
+			long long workMicroseconds = 0;
+			for (unsigned int i = 0; i < kNumWorkTimes; ++i)
+			{
+				workMicroseconds = workTimes[i] > workMicroseconds ? workTimes[i] : workMicroseconds;
+			}
+			WaitUntil(lastPresentTime + refreshPeriod - std::chrono::microseconds(workMicroseconds + s_kLowLatencyMarginMicroseconds));
+		}
+		const auto inputTime = std::chrono::high_resolution_clock::now();
+		m_pProfiler->BeginFrame();	// ожидание событий в кадр не входит
+		{
+			HP_TRACE_SCOPE("App::PollEvents");
+			ProfileScope profileScope(m_pProfiler, kProfileStage_Input);
+			bHadEvents = PollInput(gameInput, bDone) || bHadEvents;
 		}
 
 		Uint32 currentTimeMs = SDL_GetTicks();
@@ -288,10 +869,54 @@ void App::Run()
 		float deltaTimeSeconds = 0.000001f * (float)deltaTimeMicroseconds.count();
 		lastTime = currentTime;
 
-		m_pGame->Update(gameInput, deltaTimeSeconds);
+		{
+			ProfileScope profileScope(m_pProfiler, kProfileStage_Update);
+			if (m_pInputQueue)
+			{
+				const long long frameTimeMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(currentTime.time_since_epoch()).count();
+				m_pGame->UpdateTimed(gameInput, m_timedInputs.data(), (unsigned int)m_timedInputs.size(), frameTimeMicroseconds, deltaTimeSeconds);
+			}
+			else
+			{
+				m_pGame->Update(gameInput, deltaTimeSeconds);
+			}
+		}
 
-		m_pRenderer->Clear();
-		m_pGame->Draw(*m_pRenderer);
-		m_pRenderer->Present();
+		// статичный экран перерисовываем только после событий (ввод, смена состояния, перекрытие окна)
+		bRedraw = bRedraw || bHadEvents || !m_options.bIdle || !m_pGame->IsStatic();
+		if (bRedraw)
+		{
+			m_pRenderer->Clear();
+			{
+				ProfileScope profileScope(m_pProfiler, kProfileStage_Draw);
+				m_pGame->Draw(*m_pRenderer);
+			}
+			if (m_bShowProfiler)
+			{
+				DrawProfilerOverlay();
+			}
+			const auto presentTime = std::chrono::high_resolution_clock::now();
+			m_pRenderer->Present();
+			lastPresentTime = std::chrono::high_resolution_clock::now();
+			bHasLastPresent = true;
+			workTimes[workTimeIndex] = std::chrono::duration_cast<std::chrono::microseconds>(presentTime - inputTime).count();
+			workTimeIndex = (workTimeIndex + 1) % kNumWorkTimes;
+			OnFramePresented(m_pendingInputTimestamps, m_numPendingInputs);
+			m_numPendingInputs = 0;
+			m_pProfiler->EndFrame();	// в статистику идут только нарисованные кадры
+			bRedraw = false;
+		}
+
+		// ограничение частоты кадров
+		if (m_options.fpsCap > 0)
+		{
+			auto now = std::chrono::high_resolution_clock::now();
+			if (now > nextFrameTime + frameDuration)
+			{
+				nextFrameTime = now;	// сильно отстали (например, после ожидания событий) - не догоняем
+			}
+			WaitUntil(nextFrameTime);
+			nextFrameTime += frameDuration;
+		}
 	}
 }
\ No newline at end of file
@@ -1,34 +1,107 @@
 
 //--------------------------------------------------------------------------------------------------
 /**
-	\   App.h
+	\файл   App.h
 **/
 //--------------------------------------------------------------------------------------------------
 
 #ifndef APP_H
 #define APP_H
 
+#include "GameSnapshot.h"
+#include "InputQueue.h"
+
+#include <atomic>
+#include <vector>
+
 // SDL 
 struct SDL_Window;
+union SDL_Event;
 
 class Game;
+class LatencyHistogram;
+class Profiler;
 class Renderer;
 
+// параметры запуска из командной строки
+struct AppOptions
+{
+	bool			bFullScreen;
+	unsigned int	displayWidth;
+	unsigned int	displayHeight;
+	unsigned int	seed;			// зерно первой партии
+	const char*		pRecordPath;	// куда писать запись партии, nullptr - не записывать
+	bool			bAutoplay;		// фигурами управляет автоигрок
+	unsigned int	aiSearchDepth;	// сколько фигур из очереди учитывает автоигрок (1 - только текущую)
+	unsigned int	aiBeamWidth;	// сколько лучших полей автоигрок оставляет на каждом шаге
+	unsigned int	aiTableMegabytes;	// таблица оценённых позиций автоигрока, 0 - без таблицы
+	unsigned int	autoShiftDelayMs;	// через сколько зажатая стрелка начинает сдвигать фигуру
+	unsigned int	autoRepeatMs;		// период сдвигов зажатой стрелкой, 0 - сразу до упора
+	FieldSize		fieldSize;
+	bool			bVsync;
+	unsigned int	fpsCap;			// ограничение кадров в секунду без vsync, 0 - без ограничения
+	bool			bIdle;			// на статичных экранах ждать событий и не перерисовывать
+	bool			bLowLatency;	// опрашивать ввод перед самым vsync и не давать драйверу копить кадры
+	bool			bInputThread;	// события SDL принимает главный поток, игра и отрисовка идут в своём
+	bool			bRenderThread;	// отрисовка в своём потоке по снимкам игры, симуляция её не ждёт
+	const char*		pProfileCsvPath;	// куда записать времена кадров при выходе, nullptr - не записывать
+	const char*		pTracePath;			// трасса Chrome при сборке с HP_TRACE_ENABLED, nullptr - trace.json
+};
+
 class App
 {
 public:
 
 	App();
 
-	bool	Init(bool bFullScreen, unsigned int logicalWidth, unsigned int logicalHeight);
+	bool	Init(const AppOptions& options);
 	void	ShutDown();
 	void	Run();
 
 private:
 
+	void	CreateRenderer();
+	void	RunGameLoop();
+	void	RunEventLoop();		// поток событий при bInputThread
+	void	RunSimulationLoop();	// поток игры при bRenderThread: такты и снимки, без отрисовки
+	void	RunRenderLoop();		// поток отрисовки при bRenderThread
+	bool	PollInput(GameInput& gameInput, bool& bDone);	// true - были события
+	bool	WaitForInput(GameInput& gameInput, bool& bDone);	// сон на статичном экране; true - событие уже разобрано
+	void	PublishSnapshot();
+	bool	HandleEvent(const SDL_Event& event, InputRecord& record) const;	// false - событие не нужно
+	void	ApplyInput(const InputRecord& record, GameInput& gameInput, bool& bDone);
+	void	DrawProfilerOverlay();
+	void	OnFramePresented(const unsigned int* pInputTimestampsMs, unsigned int numInputTimestamps);
+
+	static const unsigned int kMaxPendingInputs = 64;
+	static const unsigned int kNumWorkTimes = 32;
+
+	AppOptions			m_options;
 	SDL_Window*			m_pWindow;
 	Renderer*			m_pRenderer;
 	Game*				m_pGame;
+	Profiler*			m_pProfiler;
+	std::atomic<bool>	m_bShowProfiler;	// F1
+
+	// задержка ввода: метки времени нажатий, ещё не попавших на экран
+	LatencyHistogram*	m_pLatencyHistogram;
+	unsigned int		m_pendingInputTimestamps[kMaxPendingInputs];
+	unsigned int		m_numPendingInputs;
+	unsigned int		m_numDroppedInputs;		// не поместились в очередь, в гистограмму не попали
+
+	// поток событий: пишет в очередь, поток игры читает
+	InputQueue*			m_pInputQueue;	// nullptr - события разбираются в цикле игры
+	std::vector<InputRecord>	m_timedInputs;	// записи очереди за кадр, память переиспользуется
+	std::atomic<bool>	m_bGameLoopDone;
+	unsigned int		m_numDroppedInputRecords;	// очередь была полна
+
+	// поток отрисовки: поток игры публикует снимки, поток отрисовки рисует последний
+	GameSnapshotBuffer*	m_pSnapshotBuffer;	// nullptr - игра и отрисовка в одном потоке
+	bool				m_bSnapshotDropped;		// прошлый снимок не нарисован, его нажатия переходят в следующий
+	std::atomic<bool>	m_bRenderTargetsLost;	// событие пришло в поток игры, текстуры сбрасывает поток отрисовки
+	// время ввода и тактов в потоке игры с прошлого кадра: профайлер принадлежит потоку отрисовки, он и забирает
+	std::atomic<long long>	m_simulationInputNanoseconds;
+	std::atomic<long long>	m_simulationUpdateNanoseconds;
 };
 
 #endif // APP_H
@@ -0,0 +1,543 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    AutoPlayer.cpp
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "AutoPlayer.h"
+
+#include "Debug.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// веса оценки поля (подобраны генетическим алгоритмом для поля 10x20)
+static const float s_kAggregateHeightWeight = -0.510066f;
+static const float s_kLinesClearedWeight = 0.760666f;
+static const float s_kHolesWeight = -0.35663f;
+static const float s_kBumpinessWeight = -0.184483f;
+
+// если фигура не дошла до цели за столько тактов (мешают блоки), она бросается там, где есть
+static const unsigned int s_kMaxTicksPerTetromino = 32;
+
+// поворотов одного узла, раздаваемых потоку за раз
+static const uint64_t s_kExpandGrainSize = 4;
+
+//--------------------------------------------------------------------------------------------------
+// хелперы
+
+static unsigned int CountBits(FieldRowMask mask)
+{
+#if defined(_MSC_VER)
+	return (unsigned int)__popcnt64(mask);
+#else
+	return (unsigned int)__builtin_popcountll(mask);
+#endif
+}
+
+static unsigned int CountTrailingZeros(FieldRowMask mask)
+{
+	HP_ASSERT(mask != 0);
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	return index;
+#else
+	return (unsigned int)__builtin_ctzll(mask);
+#endif
+}
+
+static FieldRowMask ShiftRowMask(FieldRowMask rowMask, int x)
+{
+	return x >= 0 ? (FieldRowMask)(rowMask << x) : (FieldRowMask)(rowMask >> -x);
+}
+
+// поле после падения фигуры: все строки (с запасными под полем) пишутся в rows, полные строки удаляются.
+// Возвращает число удалённых строк, topY - верхняя строка, в которой могут быть блоки
+static unsigned int PlaceTetromino(const Field& field, const TetrominoInstance& landedInstance, FieldRowMask* rows, int& topY)
+{
+	// строки выше верхнего блока поля и фигуры пусты - их не копируем и не просматриваем
+	const PieceMask& mask = Simulation::GetPieceMask(landedInstance.m_tetrominoType, landedInstance.m_rotation);
+	const unsigned int height = field.height;
+	topY = landedInstance.m_pos.y + mask.minY;
+	for (unsigned int x = 0; x < field.width; ++x)
+	{
+		topY = field.columnTops[x] < topY ? field.columnTops[x] : topY;
+	}
+	memset(rows, 0, topY * sizeof(FieldRowMask));
+	memcpy(&rows[topY], &field.rowMasks[topY], (height + Field::kNumPaddingRows - topY) * sizeof(FieldRowMask));
+
+	unsigned int numLinesCleared = 0;
+	for (int row = mask.minY; row <= mask.maxY; ++row)
+	{
+		const unsigned int y = landedInstance.m_pos.y + row;
+		rows[y] |= ShiftRowMask(mask.rows[row], landedInstance.m_pos.x);
+		numLinesCleared += (rows[y] == field.fullRowMask) ? 1 : 0;
+	}
+
+	// полные строки выбрасываются, всё, что выше, опускается
+	if (numLinesCleared > 0)
+	{
+		unsigned int dstY = height;
+		for (unsigned int y = height; y-- > (unsigned int)topY;)
+		{
+			if (rows[y] != field.fullRowMask)
+				rows[--dstY] = rows[y];
+		}
+		for (unsigned int y = (unsigned int)topY; y < dstY; ++y)
+		{
+			rows[y] = 0;
+		}
+		topY = (int)dstY;
+	}
+	return numLinesCleared;
+}
+
+// оценка поля: больше - лучше. Заодно пишет высоты столбцов в формате Field::columnTops
+static float EvaluateRows(const FieldRowMask* rows, int topY, unsigned int width, unsigned int height, unsigned int numLinesCleared,
+	int* columnTops)
+{
+	// высоты столбцов и дыры (пустые клетки под блоками) за один проход сверху вниз
+	int columnHeights[Field::kMaxWidth] = {};
+	FieldRowMask coveredColumns = 0;
+	unsigned int numHoles = 0;
+	for (unsigned int y = (unsigned int)topY; y < height; ++y)
+	{
+		const FieldRowMask row = rows[y];
+		numHoles += CountBits(coveredColumns & ~row);
+		for (FieldRowMask newColumns = row & ~coveredColumns; newColumns; newColumns &= newColumns - 1)
+		{
+			columnHeights[CountTrailingZeros(newColumns)] = (int)(height - y);
+		}
+		coveredColumns |= row;
+	}
+
+	int aggregateHeight = 0;
+	int bumpiness = 0;
+	for (unsigned int x = 0; x < width; ++x)
+	{
+		columnTops[x] = (int)height - columnHeights[x];
+		aggregateHeight += columnHeights[x];
+		if (x > 0)
+		{
+			const int delta = columnHeights[x] - columnHeights[x - 1];
+			bumpiness += delta >= 0 ? delta : -delta;
+		}
+	}
+
+	return s_kAggregateHeightWeight * aggregateHeight
+		+ s_kLinesClearedWeight * numLinesCleared
+		+ s_kHolesWeight * numHoles
+		+ s_kBumpinessWeight * bumpiness;
+}
+
+// ключ таблицы позиций: маски строк поля (от верхнего блока) и фигура в начале шага
+static uint64_t HashPosition(const Field& field, const TetrominoInstance& startInstance)
+{
+	int topY = (int)field.height;
+	for (unsigned int x = 0; x < field.width; ++x)
+	{
+		topY = field.columnTops[x] < topY ? field.columnTops[x] : topY;
+	}
+
+	uint64_t hash = 0x9e3779b97f4a7c15ull * (1 + startInstance.m_tetrominoType + (startInstance.m_rotation << 3)
+		+ ((uint64_t)(startInstance.m_pos.x + 128) << 8) + ((uint64_t)startInstance.m_pos.y << 16));
+	for (unsigned int y = (unsigned int)topY; y < field.height; ++y)
+	{
+		hash ^= field.rowMasks[y] + y;	// строка занимает все 64 бита, номер строки подмешивается сложением
+		hash *= 0xbf58476d1ce4e5b9ull;
+		hash ^= hash >> 31;
+	}
+	hash ^= hash >> 33;
+	hash *= 0x94d049bb133111ebull;
+	hash ^= hash >> 29;
+	return hash != 0 ? hash : 1;	// 0 - пустая запись таблицы
+}
+
+//--------------------------------------------------------------------------------------------------
+
+AutoPlayer::AutoPlayer()
+	: m_arenaWidth(0)
+	, m_arenaHeight(0)
+	, m_rowsPerNode(0)
+	, m_childrenPerRotation(0)
+	, m_childrenPerNode(0)
+	, m_fullRowMask(0)
+	, m_numHiddenRows(0)
+	, m_bRootStep(true)
+	, m_numPlacementsEvaluated(0)
+	, m_targetTetrominoIndex(0)
+	, m_numTicksOnTarget(0)
+	, m_bHasTarget(false)
+	, m_numSearches(0)
+	, m_searchSeconds(0.0)
+	, m_lastSearchSeconds(0.0)
+	, m_maxSearchSeconds(0.0)
+{
+	m_target.rotation = 0;
+	m_target.x = 0;
+	m_target.score = 0.0f;
+	m_expandFunction = [this](unsigned int workerIndex, uint64_t begin, uint64_t end)
+	{
+		HP_UNUSED(workerIndex);
+		ExpandItems(begin, end);
+	};
+	m_leafFunction = [this](unsigned int workerIndex, uint64_t begin, uint64_t end)
+	{
+		HP_UNUSED(workerIndex);
+		EvaluateLeaves(begin, end);
+	};
+	Configure(GetDefaultSettings());
+}
+
+AutoPlayer::~AutoPlayer()
+{
+}
+
+AutoPlayer::Settings AutoPlayer::GetDefaultSettings()
+{
+	Settings settings;
+	settings.searchDepth = 1;
+	settings.beamWidth = 1;
+	settings.numThreads = 1;
+	settings.transpositionTableBytes = 0;
+	return settings;
+}
+
+void AutoPlayer::Configure(const Settings& settings)
+{
+	m_settings = settings;
+	m_settings.searchDepth = settings.searchDepth < 1 ? 1 : (settings.searchDepth > kMaxSearchDepth ? kMaxSearchDepth : settings.searchDepth);
+	m_settings.beamWidth = settings.beamWidth < 1 ? 1 : settings.beamWidth;
+	m_pThreadPool.reset(new ThreadPool(settings.numThreads));
+	m_transpositionTable.Resize(settings.transpositionTableBytes);
+	m_arenaWidth = 0;	// арена пересоздаётся при следующем переборе
+	m_arenaHeight = 0;
+}
+
+void AutoPlayer::Reset()
+{
+	m_bHasTarget = false;
+	m_numTicksOnTarget = 0;
+}
+
+void AutoPlayer::MakeInput(const Simulation& simulation, GameInput& gameInput)
+{
+	gameInput = GameInput();
+	if (simulation.IsGameOver())
+		return;
+
+	const TetrominoInstance& activeTetromino = simulation.GetActiveTetromino();
+	if (!m_bHasTarget || m_targetTetrominoIndex != simulation.GetNumTetrominosPlaced())
+	{
+		TetrominoType nextTetrominos[Simulation::kNumNextTetrominos];
+		for (unsigned int i = 0; i < Simulation::kNumNextTetrominos; ++i)
+		{
+			nextTetrominos[i] = simulation.GetNextTetromino(i);
+		}
+
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		if (!FindBestPlacement(simulation.GetField(), activeTetromino, nextTetrominos, Simulation::kNumNextTetrominos, m_target))
+		{
+			m_target.rotation = activeTetromino.m_rotation;
+			m_target.x = activeTetromino.m_pos.x;
+		}
+		m_lastSearchSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+		m_searchSeconds += m_lastSearchSeconds;
+		m_maxSearchSeconds = m_lastSearchSeconds > m_maxSearchSeconds ? m_lastSearchSeconds : m_maxSearchSeconds;
+		++m_numSearches;
+
+		m_targetTetrominoIndex = simulation.GetNumTetrominosPlaced();
+		m_numTicksOnTarget = 0;
+		m_bHasTarget = true;
+	}
+
+	// сначала поворот, потом сдвиг, потом падение - в том же порядке, в каком перебирались места.
+	// На широком поле до цели дольше: даём не меньше тактов, чем нужно на все повороты и сдвиг через всё поле
+	const unsigned int fullTraverseTicks = Tetromino::kNumRotations + simulation.GetField().width;
+	const unsigned int maxTicks = fullTraverseTicks > s_kMaxTicksPerTetromino ? fullTraverseTicks : s_kMaxTicksPerTetromino;
+	if (++m_numTicksOnTarget > maxTicks)
+		gameInput.bHardDrop = true;
+	else if (activeTetromino.m_rotation != m_target.rotation)
+		gameInput.bRotateClockwise = true;
+	else if (activeTetromino.m_pos.x < m_target.x)
+		gameInput.bMoveRight = true;
+	else if (activeTetromino.m_pos.x > m_target.x)
+		gameInput.bMoveLeft = true;
+	else
+		gameInput.bHardDrop = true;
+}
+
+bool AutoPlayer::FindBestPlacement(const Field& field, const TetrominoInstance& startInstance,
+	const TetrominoType* nextTetrominos, unsigned int numNextTetrominos, Placement& placement)
+{
+	if (m_arenaWidth != field.width || m_arenaHeight != field.height)
+	{
+		AllocateArena(field);
+	}
+	m_fullRowMask = field.fullRowMask;
+	m_numHiddenRows = field.numHiddenRows;
+	m_transpositionTable.NewSearch();
+
+	// корень - текущее поле
+	memcpy(m_parentRows.data(), field.rowMasks, m_rowsPerNode * sizeof(FieldRowMask));
+	memcpy(m_parentColumnTops.data(), field.columnTops, field.width * sizeof(int));
+	SearchNode& root = m_parents[0];
+	root.score = 0.0f;
+	root.numLinesCleared = 0;
+	root.firstRotation = startInstance.m_rotation;
+	root.firstX = startInstance.m_pos.x;
+	root.bValid = true;
+	unsigned int numParents = 1;
+
+	const unsigned int searchDepth = m_settings.searchDepth < 1 + numNextTetrominos ? m_settings.searchDepth : 1 + numNextTetrominos;
+	for (unsigned int depth = 0; depth + 1 < searchDepth; ++depth)
+	{
+		m_bRootStep = (depth == 0);
+		m_stepStartInstance = m_bRootStep ? startInstance : Simulation::GetSpawnInstance(nextTetrominos[depth - 1], field);
+
+		// каждый поворот каждого узла - отдельная задача, дети пишутся в свои ячейки арены
+		m_pThreadPool->ParallelFor(0, (uint64_t)numParents * Tetromino::kNumRotations, s_kExpandGrainSize, m_expandFunction);
+
+		unsigned int numCandidates = 0;
+		const unsigned int numChildren = numParents * m_childrenPerNode;
+		for (unsigned int i = 0; i < numChildren; ++i)
+		{
+			if (m_children[i].bValid)
+				m_childOrder[numCandidates++] = i;
+		}
+		if (numCandidates == 0)
+		{
+			// дальше фигуру поставить некуда - решает лучший узел предыдущего шага
+			if (depth == 0)
+				return false;
+
+			placement.rotation = m_parents[0].firstRotation;
+			placement.x = m_parents[0].firstX;
+			placement.score = m_parents[0].score;
+			return true;
+		}
+
+		// лучшие beamWidth полей; при равной оценке - меньший номер, чтобы выбор не зависел от числа потоков
+		const unsigned int numSelected = numCandidates < m_settings.beamWidth ? numCandidates : m_settings.beamWidth;
+		const std::vector<SearchNode>& children = m_children;
+		std::partial_sort(m_childOrder.begin(), m_childOrder.begin() + numSelected, m_childOrder.begin() + numCandidates,
+			[&children](unsigned int a, unsigned int b)
+			{
+				return children[a].score != children[b].score ? children[a].score > children[b].score : a < b;
+			});
+
+		for (unsigned int i = 0; i < numSelected; ++i)
+		{
+			const unsigned int childIndex = m_childOrder[i];
+			m_parents[i] = m_children[childIndex];
+			memcpy(&m_parentRows[i * m_rowsPerNode], &m_childRows[childIndex * m_rowsPerNode], m_rowsPerNode * sizeof(FieldRowMask));
+			memcpy(&m_parentColumnTops[i * m_arenaWidth], &m_childColumnTops[childIndex * m_arenaWidth], m_arenaWidth * sizeof(int));
+		}
+		numParents = numSelected;
+	}
+
+	// последний шаг: для каждого узла нужен только лучший ход, он берётся из таблицы позиций или перебором
+	const unsigned int lastDepth = searchDepth - 1;
+	m_bRootStep = (lastDepth == 0);
+	m_stepStartInstance = m_bRootStep ? startInstance : Simulation::GetSpawnInstance(nextTetrominos[lastDepth - 1], field);
+	m_pThreadPool->ParallelFor(0, numParents, 1, m_leafFunction);
+
+	int bestParent = -1;
+	float bestScore = 0.0f;
+	for (unsigned int i = 0; i < numParents; ++i)
+	{
+		if (!m_leafResults[i].bValid)
+			continue;
+
+		const float score = m_leafResults[i].score + s_kLinesClearedWeight * m_parents[i].numLinesCleared;
+		if (bestParent < 0 || score > bestScore)
+		{
+			bestParent = (int)i;
+			bestScore = score;
+		}
+	}
+
+	if (bestParent < 0)
+	{
+		if (lastDepth == 0)
+			return false;
+
+		bestParent = 0;
+		bestScore = m_parents[0].score;
+	}
+
+	const LeafResult& leafResult = m_leafResults[bestParent];
+	placement.rotation = m_bRootStep ? leafResult.rotation : m_parents[bestParent].firstRotation;
+	placement.x = m_bRootStep ? leafResult.x : m_parents[bestParent].firstX;
+	placement.score = bestScore;
+	return true;
+}
+
+void AutoPlayer::AllocateArena(const Field& field)
+{
+	m_arenaWidth = field.width;
+	m_arenaHeight = field.height;
+	m_rowsPerNode = field.height + Field::kNumPaddingRows;
+	m_childrenPerRotation = field.width + Tetromino::kNumBlocks - 1;	// фигура может стоять левее поля на 3 столбца
+	m_childrenPerNode = Tetromino::kNumRotations * m_childrenPerRotation;
+
+	const unsigned int numParents = m_settings.beamWidth;
+	const unsigned int numChildren = numParents * m_childrenPerNode;
+	m_parents.resize(numParents);
+	m_parentRows.resize(numParents * m_rowsPerNode);
+	m_parentColumnTops.resize(numParents * m_arenaWidth);
+	m_children.resize(numChildren);
+	m_childRows.resize(numChildren * m_rowsPerNode);
+	m_childColumnTops.resize(numChildren * m_arenaWidth);
+	m_childOrder.resize(numChildren);
+	m_leafResults.resize(numParents);
+}
+
+Field AutoPlayer::GetNodeField(std::vector<FieldRowMask>& rows, std::vector<int>& columnTops, unsigned int nodeIndex) const
+{
+	Field field;
+	field.width = m_arenaWidth;
+	field.height = m_arenaHeight;
+	field.numHiddenRows = m_numHiddenRows;
+	field.staticBlocks = nullptr;	// перебору нужны только маски
+	field.rowMasks = &rows[nodeIndex * m_rowsPerNode];
+	field.columnTops = &columnTops[nodeIndex * m_arenaWidth];
+	field.fullRowMask = m_fullRowMask;
+	return field;
+}
+
+void AutoPlayer::ExpandItems(uint64_t begin, uint64_t end)
+{
+	for (uint64_t item = begin; item < end; ++item)
+	{
+		const unsigned int parentIndex = (unsigned int)(item / Tetromino::kNumRotations);
+		ExpandNode(parentIndex, (unsigned int)(item % Tetromino::kNumRotations), m_parents[parentIndex].numLinesCleared);
+	}
+}
+
+void AutoPlayer::EvaluateLeaves(uint64_t begin, uint64_t end)
+{
+	for (uint64_t parentIndex = begin; parentIndex < end; ++parentIndex)
+	{
+		EvaluateLeaf((unsigned int)parentIndex);
+	}
+}
+
+// лучший ход фигуры последнего шага на поле узла parentIndex
+void AutoPlayer::EvaluateLeaf(unsigned int parentIndex)
+{
+	LeafResult& result = m_leafResults[parentIndex];
+
+	// одно и то же поле встречается в луче несколько раз: симметричные повороты, разный порядок ходов
+	uint64_t key = 0;
+	if (m_transpositionTable.IsEnabled())
+	{
+		key = HashPosition(GetNodeField(m_parentRows, m_parentColumnTops, parentIndex), m_stepStartInstance);
+		if (m_transpositionTable.Probe(key, result.score, result.rotation, result.x))
+		{
+			result.bValid = true;
+			return;
+		}
+	}
+
+	// дети считаются без линий, удалённых по пути к узлу: так оценка зависит только от поля и её можно хранить в таблице
+	for (unsigned int numRotations = 0; numRotations < Tetromino::kNumRotations; ++numRotations)
+	{
+		ExpandNode(parentIndex, numRotations, 0);
+	}
+
+	result.bValid = false;
+	const unsigned int firstChild = parentIndex * m_childrenPerNode;
+	for (unsigned int i = 0; i < m_childrenPerNode; ++i)
+	{
+		const SearchNode& child = m_children[firstChild + i];
+		if (!child.bValid || (result.bValid && child.score <= result.score))
+			continue;
+
+		// ход восстанавливается по ячейке: номер поворота - число нажатий, затем столбец
+		const unsigned int numRotations = i / m_childrenPerRotation;
+		result.score = child.score;
+		result.rotation = (m_stepStartInstance.m_rotation + Tetromino::kNumRotations * 2 - numRotations) % Tetromino::kNumRotations;
+		result.x = (int)(i % m_childrenPerRotation) - (int)(Tetromino::kNumBlocks - 1);
+		result.bValid = true;
+	}
+
+	if (result.bValid && key != 0)
+	{
+		m_transpositionTable.Store(key, result.score, result.rotation, result.x);
+	}
+}
+
+// все места фигуры шага в одном повороте (numRotations нажатий по часовой стрелке) для узла parentIndex;
+// baseLinesCleared - сколько линий прибавить к удалённым этой фигурой
+void AutoPlayer::ExpandNode(unsigned int parentIndex, unsigned int numRotations, unsigned int baseLinesCleared)
+{
+	const unsigned int firstChild = parentIndex * m_childrenPerNode + numRotations * m_childrenPerRotation;
+	for (unsigned int i = 0; i < m_childrenPerRotation; ++i)
+	{
+		m_children[firstChild + i].bValid = false;
+	}
+
+	const SearchNode& parent = m_parents[parentIndex];
+	const Field field = GetNodeField(m_parentRows, m_parentColumnTops, parentIndex);
+
+	// поворот по часовой стрелке уменьшает номер поворота, как в Simulation::Update; повороты без
+	// отскока от стены: место, куда можно попасть только отскоком, просто не рассматривается
+	TetrominoInstance rotatedInstance = m_stepStartInstance;
+	const FieldRowMask* rotationRows[Tetromino::kNumRotations];
+	for (unsigned int i = 0; i <= numRotations; ++i)
+	{
+		if (i > 0)
+		{
+			rotatedInstance.m_rotation = (rotatedInstance.m_rotation + Tetromino::kNumRotations - 1) % Tetromino::kNumRotations;
+		}
+		if (Simulation::IsOverlap(rotatedInstance, field))
+			return;
+		rotationRows[i] = Simulation::GetPieceMask(rotatedInstance.m_tetrominoType, rotatedInstance.m_rotation).rows;
+	}
+
+	// у симметричных фигур (O) повороты совпадают - оценивает только первый из них
+	for (unsigned int i = 0; i < numRotations; ++i)
+	{
+		if (memcmp(rotationRows[i], rotationRows[numRotations], sizeof(PieceMask::rows)) == 0)
+			return;
+	}
+
+	// сдвиги влево и вправо, пока фигура не упрётся
+	unsigned long long numEvaluated = 0;
+	for (int direction = -1; direction <= 1; direction += 2)
+	{
+		TetrominoInstance testInstance = rotatedInstance;
+		if (direction > 0)
+		{
+			++testInstance.m_pos.x;	// исходный столбец уже оценён при сдвиге влево
+		}
+		while (!Simulation::IsOverlap(testInstance, field))
+		{
+			TetrominoInstance landedInstance = testInstance;
+			landedInstance.m_pos.y += Simulation::GetDropDistance(testInstance, field);
+
+			const unsigned int childIndex = firstChild + (unsigned int)(testInstance.m_pos.x + (int)Tetromino::kNumBlocks - 1);
+			SearchNode& child = m_children[childIndex];
+			FieldRowMask* childRows = &m_childRows[childIndex * m_rowsPerNode];
+			int topY;
+			child.numLinesCleared = baseLinesCleared + PlaceTetromino(field, landedInstance, childRows, topY);
+			child.score = EvaluateRows(childRows, topY, m_arenaWidth, m_arenaHeight, child.numLinesCleared,
+				&m_childColumnTops[childIndex * m_arenaWidth]);
+			child.firstRotation = m_bRootStep ? testInstance.m_rotation : parent.firstRotation;
+			child.firstX = m_bRootStep ? testInstance.m_pos.x : parent.firstX;
+			child.bValid = true;
+			++numEvaluated;
+
+			testInstance.m_pos.x += direction;
+		}
+	}
+	m_numPlacementsEvaluated.fetch_add(numEvaluated, std::memory_order_relaxed);
+}
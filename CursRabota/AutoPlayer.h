@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    AutoPlayer.h
+**/
+//--------------------------------------------------------------------------------------------------
+
+#ifndef AUTO_PLAYER_H
+#define AUTO_PLAYER_H
+
+#include "Simulation.h"
+#include "ThreadPool.h"
+#include "TranspositionTable.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Автоигрок: для каждой новой фигуры перебирает все повороты и столбцы, достижимые из места появления,
+// оценивает поле после падения и выдаёт ввод, который ведёт фигуру к лучшему месту.
+// Перебор идёт по маскам строк, поэтому одна фигура оценивается за микросекунды.
+// С глубиной больше 1 перебор лучевой: на каждом шаге по очереди фигур остаются beamWidth лучших полей
+class AutoPlayer
+{
+public:
+
+	static const unsigned int kMaxSearchDepth = 1 + Simulation::kNumNextTetrominos;
+
+	struct Settings
+	{
+		unsigned int	searchDepth;	// сколько фигур перебирать: текущая и (searchDepth - 1) из очереди
+		unsigned int	beamWidth;		// сколько лучших полей оставлять после каждой фигуры
+		unsigned int	numThreads;		// потоков для перебора, 0 - по числу ядер
+		size_t			transpositionTableBytes;	// память под таблицу оценённых позиций, 0 - без таблицы
+	};
+
+	// куда поставить фигуру
+	struct Placement
+	{
+		unsigned int	rotation;
+		int				x;
+		float			score;
+	};
+
+	AutoPlayer();
+	~AutoPlayer();
+
+	static Settings	GetDefaultSettings();	// одна фигура, один поток
+	void			Configure(const Settings& settings);
+
+	void			Reset();	// перед новой партией
+	void			MakeInput(const Simulation& simulation, GameInput& gameInput);	// ввод на один такт
+
+	// false - фигуру некуда поставить
+	bool			FindBestPlacement(const Field& field, const TetrominoInstance& startInstance,
+						const TetrominoType* nextTetrominos, unsigned int numNextTetrominos, Placement& placement);
+
+	unsigned long long	GetNumSearches() const { return m_numSearches; }
+	unsigned long long	GetNumPlacementsEvaluated() const { return m_numPlacementsEvaluated.load(std::memory_order_relaxed); }
+	double				GetSearchSeconds() const { return m_searchSeconds; }
+	double				GetLastSearchSeconds() const { return m_lastSearchSeconds; }
+	double				GetMaxSearchSeconds() const { return m_maxSearchSeconds; }
+	TranspositionTable::Stats	GetTranspositionTableStats() const { return m_transpositionTable.GetStats(); }
+
+private:
+
+	AutoPlayer(const AutoPlayer&);
+	AutoPlayer& operator=(const AutoPlayer&);
+
+	// лучший ход фигуры последнего шага для узла: на последнем шаге дети не отбираются, нужен только максимум
+	struct LeafResult
+	{
+		float			score;		// без линий, удалённых по пути к узлу
+		unsigned int	rotation;
+		int				x;
+		bool			bValid;
+	};
+
+	// поле в арене: строки и высоты столбцов лежат в общих массивах по номеру узла
+	struct SearchNode
+	{
+		float			score;
+		unsigned int	numLinesCleared;	// за весь путь от корня
+		unsigned int	firstRotation;		// ход текущей фигуры, с которого начался путь
+		int				firstX;
+		bool			bValid;
+	};
+
+	void			AllocateArena(const Field& field);
+	Field			GetNodeField(std::vector<FieldRowMask>& rows, std::vector<int>& columnTops, unsigned int nodeIndex) const;
+	void			ExpandItems(uint64_t begin, uint64_t end);
+	void			ExpandNode(unsigned int parentIndex, unsigned int numRotations, unsigned int baseLinesCleared);
+	void			EvaluateLeaves(uint64_t begin, uint64_t end);
+	void			EvaluateLeaf(unsigned int parentIndex);
+
+	Settings		m_settings;
+	std::unique_ptr<ThreadPool>	m_pThreadPool;
+	ThreadPool::RangeFunction	m_expandFunction;	// создаются один раз, чтобы не выделять память на каждый шаг
+	ThreadPool::RangeFunction	m_leafFunction;
+	TranspositionTable			m_transpositionTable;
+
+	// арена полей: память выделяется при смене размеров поля или настроек, сам перебор не выделяет память
+	unsigned int	m_arenaWidth;
+	unsigned int	m_arenaHeight;
+	unsigned int	m_rowsPerNode;
+	unsigned int	m_childrenPerRotation;
+	unsigned int	m_childrenPerNode;
+	std::vector<SearchNode>		m_parents;
+	std::vector<FieldRowMask>	m_parentRows;
+	std::vector<int>			m_parentColumnTops;
+	std::vector<SearchNode>		m_children;
+	std::vector<FieldRowMask>	m_childRows;
+	std::vector<int>			m_childColumnTops;
+	std::vector<unsigned int>	m_childOrder;
+	std::vector<LeafResult>		m_leafResults;
+
+	// текущий шаг перебора, читается потоками
+	FieldRowMask		m_fullRowMask;
+	unsigned int		m_numHiddenRows;
+	TetrominoInstance	m_stepStartInstance;
+	bool				m_bRootStep;
+	std::atomic<unsigned long long>	m_numPlacementsEvaluated;
+
+	Placement		m_target;
+	unsigned int	m_targetTetrominoIndex;		// номер фигуры в партии, для которой выбрана цель
+	unsigned int	m_numTicksOnTarget;
+	bool			m_bHasTarget;
+
+	unsigned long long	m_numSearches;
+	double				m_searchSeconds;
+	double				m_lastSearchSeconds;
+	double				m_maxSearchSeconds;
+};
+
+#endif // AUTO_PLAYER_H
@@ -0,0 +1,491 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    Bench.cpp
+
+	Замеры скорости правил игры без окна, результат в JSON для сравнения сборок
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "AutoPlayer.h"
+#include "Random.h"
+#include "Simulation.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+enum InputPolicy
+{
+	kInputPolicy_Random = 0,	// как в tetris_headless: редкие нажатия, фигура в основном падает сама
+	kInputPolicy_Drop,			// сдвиги и повороты, затем сразу быстрое падение
+	kInputPolicy_Greedy,		// каждую фигуру ставит как можно ниже - собирает линии
+	kInputPolicy_Autoplay,		// AutoPlayer: перебор мест с оценкой поля, партии длинные
+	kNumInputPolicies
+};
+
+static const char* s_inputPolicyNames[kNumInputPolicies] = { "random", "drop", "greedy", "autoplay" };
+
+// размеры полей для --field-sweep: от обычного до самого большого
+static const FieldSize s_sweepFieldSizes[] =
+{
+	{ 10, 20, 0 },
+	{ 16, 40, 0 },
+	{ 32, 200, 0 },
+	{ 64, 1000, 0 },
+};
+static const unsigned int s_kNumSweepFieldSizes = sizeof(s_sweepFieldSizes) / sizeof(s_sweepFieldSizes[0]);
+
+static double SecondsSince(BenchClock::time_point startTime)
+{
+	return std::chrono::duration<double>(BenchClock::now() - startTime).count();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+// доступ к закрытой части Simulation
+class SimulationBench
+{
+public:
+
+	typedef Simulation::AddTimer AddTimer;
+
+	static void SetAddTimer(Simulation& simulation, AddTimer* pAddTimer)
+	{
+		simulation.m_pAddTimer = pAddTimer;
+	}
+};
+
+// цель для текущей фигуры в политике greedy
+struct GreedyTarget
+{
+	unsigned int	numTetrominosPlaced;	// для какой фигуры выбрана цель
+	unsigned int	rotation;
+	int				x;
+};
+
+static void ChooseGreedyTarget(const Simulation& simulation, GreedyTarget& target)
+{
+	const Field& field = simulation.GetField();
+	const TetrominoInstance& activeTetromino = simulation.GetActiveTetromino();
+	const Tetromino& tetromino = Simulation::GetTetromino(activeTetromino.m_tetrominoType);
+
+	target.numTetrominosPlaced = simulation.GetNumTetrominosPlaced();
+	target.rotation = activeTetromino.m_rotation;
+	target.x = activeTetromino.m_pos.x;
+
+	int bestScore = -1;
+	for (unsigned int rotation = 0; rotation < Tetromino::kNumRotations; ++rotation)
+	{
+		for (int x = -2; x < (int)field.width; ++x)
+		{
+			TetrominoInstance testInstance = activeTetromino;
+			testInstance.m_rotation = rotation;
+			testInstance.m_pos.x = x;
+			if (Simulation::IsOverlap(testInstance, field))
+				continue;
+
+			// сумма строк блоков после падения: чем ниже и площе лежит фигура, тем больше
+			const int landingY = testInstance.m_pos.y + Simulation::GetDropDistance(testInstance, field);
+			int score = 0;
+			for (unsigned int i = 0; i < Tetromino::kNumBlocks; ++i)
+			{
+				score += landingY + (int)tetromino.blockCoord[rotation][i].y;
+			}
+			if (score > bestScore)
+			{
+				bestScore = score;
+				target.rotation = rotation;
+				target.x = x;
+			}
+		}
+	}
+}
+
+static void MakeGreedyInput(const Simulation& simulation, GreedyTarget& target, GameInput& gameInput)
+{
+	gameInput = GameInput();
+	if (target.numTetrominosPlaced != simulation.GetNumTetrominosPlaced())
+	{
+		ChooseGreedyTarget(simulation, target);
+	}
+
+	const TetrominoInstance& activeTetromino = simulation.GetActiveTetromino();
+	if (activeTetromino.m_rotation != target.rotation)
+		gameInput.bRotateClockwise = true;
+	else if (activeTetromino.m_pos.x < target.x)
+		gameInput.bMoveRight = true;
+	else if (activeTetromino.m_pos.x > target.x)
+		gameInput.bMoveLeft = true;
+	else
+		gameInput.bHardDrop = true;
+}
+
+static void MakeInput(InputPolicy policy, Random& random, GameInput& gameInput)
+{
+	gameInput = GameInput();
+
+	const unsigned int r = random.NextBelow(100);
+	if (policy == kInputPolicy_Random)
+	{
+		if (r < 10)
+			gameInput.bMoveLeft = true;
+		else if (r < 20)
+			gameInput.bMoveRight = true;
+		else if (r < 25)
+			gameInput.bRotateClockwise = true;
+		else if (r < 30)
+			gameInput.bSoftDrop = true;
+		else if (r < 32)
+			gameInput.bHardDrop = true;
+	}
+	else
+	{
+		if (r < 35)
+			gameInput.bMoveLeft = true;
+		else if (r < 70)
+			gameInput.bMoveRight = true;
+		else if (r < 85)
+			gameInput.bRotateClockwise = true;
+		else
+			gameInput.bHardDrop = true;
+	}
+}
+
+struct GamesResult
+{
+	unsigned long long	ticks;
+	unsigned long long	placements;
+	unsigned long long	lines;
+	unsigned long long	totalScore;
+	double				seconds;
+};
+
+// целые партии: Update за Update, как в игре
+static void RunGames(const FieldSize& fieldSize, unsigned int numGames, unsigned int seed, InputPolicy policy, unsigned int maxTicksPerGame,
+	GamesResult& result)
+{
+	memset(&result, 0, sizeof(result));
+
+	Simulation simulation;
+	simulation.SetFieldSize(fieldSize);
+	AutoPlayer autoPlayer;
+	const BenchClock::time_point startTime = BenchClock::now();
+	for (unsigned int game = 0; game < numGames; ++game)
+	{
+		Random inputRandom((uint64_t)(seed + game) * 0x9e3779b97f4a7c15ull + 1);
+		simulation.NewGame(seed + game);
+		autoPlayer.Reset();
+		GreedyTarget greedyTarget;
+		ChooseGreedyTarget(simulation, greedyTarget);
+
+		unsigned int tick = 0;
+		while (!simulation.IsGameOver() && tick < maxTicksPerGame)
+		{
+			GameInput gameInput;
+			if (policy == kInputPolicy_Greedy)
+				MakeGreedyInput(simulation, greedyTarget, gameInput);
+			else if (policy == kInputPolicy_Autoplay)
+				autoPlayer.MakeInput(simulation, gameInput);
+			else
+				MakeInput(policy, inputRandom, gameInput);
+			simulation.Update(gameInput);
+			++tick;
+		}
+
+		result.ticks += tick;
+		result.placements += simulation.GetNumTetrominosPlaced();
+		result.lines += simulation.GetNumLinesCleared();
+		result.totalScore += simulation.GetScore();
+	}
+	result.seconds = SecondsSince(startTime);
+}
+
+// IsOverlap на поле из середины партии, для случайных положений фигур.
+// Вызовы идут целыми проходами по набору положений, поэтому их может быть больше numCalls: сколько на самом деле - в numCallsMade
+static double MeasureIsOverlap(const FieldSize& fieldSize, unsigned int seed, unsigned int numCalls, unsigned int& numOverlaps,
+	unsigned long long& numCallsMade)
+{
+	Simulation simulation;
+	simulation.SetFieldSize(fieldSize);
+	simulation.NewGame(seed);
+	Random random(seed);
+	for (unsigned int tick = 0; tick < 4000 && !simulation.IsGameOver(); ++tick)
+	{
+		GameInput gameInput;
+		MakeInput(kInputPolicy_Drop, random, gameInput);
+		simulation.Update(gameInput);
+	}
+	const Field& field = simulation.GetField();
+
+	static const unsigned int s_kNumInstances = 4096;
+	std::vector<TetrominoInstance> instances(s_kNumInstances);
+	for (TetrominoInstance& instance : instances)
+	{
+		instance.m_tetrominoType = (TetrominoType)random.NextBelow(kNumTetrominoTypes);
+		instance.m_rotation = random.NextBelow(Tetromino::kNumRotations);
+		instance.m_pos.x = (int)random.NextBelow(field.width + 3) - 2;
+		instance.m_pos.y = (int)random.NextBelow(field.height);
+	}
+
+	numOverlaps = 0;
+	const unsigned int numRounds = (numCalls + s_kNumInstances - 1) / s_kNumInstances;
+	const BenchClock::time_point startTime = BenchClock::now();
+	for (unsigned int round = 0; round < numRounds; ++round)
+	{
+		for (const TetrominoInstance& instance : instances)
+		{
+			numOverlaps += Simulation::IsOverlap(instance, field) ? 1 : 0;
+		}
+	}
+	const double seconds = SecondsSince(startTime);
+	numCallsMade = (unsigned long long)numRounds * s_kNumInstances;
+	return numCallsMade ? seconds * 1e9 / (double)numCallsMade : 0.0;
+}
+
+// сколько стоит сам замер: пара вызовов часов без работы между ними
+static double MeasureClockOverheadSeconds()
+{
+	static const unsigned int s_kNumSamples = 100000;
+	double seconds = 0.0;
+	for (unsigned int i = 0; i < s_kNumSamples; ++i)
+	{
+		const BenchClock::time_point startTime = BenchClock::now();
+		seconds += SecondsSince(startTime);
+	}
+	return seconds / s_kNumSamples;
+}
+
+// AddTetronimoToField замеряется внутри Update настоящих партий (greedy, чтобы были и удаления строк):
+// каждое закрепление фигуры, и быстрым падением, и падением под тяжестью, на настоящем поле
+static const unsigned int s_kMaxPlacementsPerGame = 2000;
+
+static double MeasureAddTetronimoToField(const FieldSize& fieldSize, unsigned int numGames, unsigned int seed, unsigned long long& numPlacements)
+{
+	Simulation simulation;
+	simulation.SetFieldSize(fieldSize);
+	SimulationBench::AddTimer addTimer = {};
+	SimulationBench::SetAddTimer(simulation, &addTimer);
+	for (unsigned int game = 0; game < numGames; ++game)
+	{
+		simulation.NewGame(seed + game);
+		GreedyTarget greedyTarget;
+		ChooseGreedyTarget(simulation, greedyTarget);
+		while (!simulation.IsGameOver() && simulation.GetNumTetrominosPlaced() < s_kMaxPlacementsPerGame)
+		{
+			GameInput gameInput;
+			MakeGreedyInput(simulation, greedyTarget, gameInput);
+			simulation.Update(gameInput);
+		}
+	}
+	SimulationBench::SetAddTimer(simulation, nullptr);
+
+	numPlacements = addTimer.numCalls;
+	if (numPlacements == 0)
+		return 0.0;
+
+	const double seconds = addTimer.seconds - MeasureClockOverheadSeconds() * (double)numPlacements;
+	return (seconds > 0.0 ? seconds : 0.0) * 1e9 / (double)numPlacements;
+}
+
+// NewGame на одном и том же объекте: память поля не выделяется заново, остаётся очистка клеток
+static double MeasureNewGame(const FieldSize& fieldSize, unsigned int seed, unsigned int numCalls)
+{
+	Simulation simulation;
+	simulation.SetFieldSize(fieldSize);
+	simulation.NewGame(seed);
+	const BenchClock::time_point startTime = BenchClock::now();
+	for (unsigned int i = 0; i < numCalls; ++i)
+	{
+		simulation.NewGame(seed + i);
+	}
+	const double seconds = SecondsSince(startTime);
+	return numCalls ? seconds * 1e9 / numCalls : 0.0;
+}
+
+// все замеры для одного размера поля
+struct FieldSizeResult
+{
+	FieldSize			fieldSize;
+	unsigned int		numGames;
+	GamesResult			games;
+	unsigned int		numOverlaps;
+	unsigned long long	numOverlapCalls;
+	double				nsPerIsOverlap;
+	unsigned long long	numAddPlacements;
+	double				nsPerAddTetronimo;
+	double				nsPerNewGame;
+};
+
+static void MeasureFieldSize(const FieldSize& fieldSize, unsigned int numGames, unsigned int seed, InputPolicy policy,
+	unsigned int maxTicksPerGame, unsigned int numOverlapCalls, FieldSizeResult& result)
+{
+	result.fieldSize = fieldSize;
+	result.numGames = numGames;
+	RunGames(fieldSize, numGames, seed, policy, maxTicksPerGame, result.games);
+	result.numOverlaps = 0;
+	result.numOverlapCalls = 0;
+	result.nsPerIsOverlap = MeasureIsOverlap(fieldSize, seed, numOverlapCalls, result.numOverlaps, result.numOverlapCalls);
+	result.numAddPlacements = 0;
+	result.nsPerAddTetronimo = MeasureAddTetronimoToField(fieldSize, numGames, seed, result.numAddPlacements);
+	result.nsPerNewGame = MeasureNewGame(fieldSize, seed, 1000);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+	unsigned int numGames = 2000;
+	unsigned int seed = 1;
+	unsigned int maxTicksPerGame = 1000000;
+	unsigned int numOverlapCalls = 20000000;
+	InputPolicy policy = kInputPolicy_Greedy;
+	FieldSize fieldSize = Simulation::GetDefaultFieldSize();
+	bool bFieldSweep = false;
+	const char* pLabel = "";
+	const char* pOutputPath = nullptr;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+		{
+			numGames = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--max-ticks") == 0 && i + 1 < argc)
+		{
+			maxTicksPerGame = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--overlap-calls") == 0 && i + 1 < argc)
+		{
+			numOverlapCalls = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc)
+		{
+			++i;
+			policy = kNumInputPolicies;
+			for (unsigned int p = 0; p < kNumInputPolicies; ++p)
+			{
+				if (strcmp(argv[i], s_inputPolicyNames[p]) == 0)
+					policy = (InputPolicy)p;
+			}
+			if (policy == kNumInputPolicies)
+			{
+				fprintf(stderr, "Unknown policy: %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--field-width") == 0 && i + 1 < argc)
+		{
+			fieldSize.width = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--field-height") == 0 && i + 1 < argc)
+		{
+			fieldSize.height = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--hidden-rows") == 0 && i + 1 < argc)
+		{
+			fieldSize.numHiddenRows = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--field-sweep") == 0)
+		{
+			bFieldSweep = true;
+		}
+		else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc)
+		{
+			pLabel = argv[++i];
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			pOutputPath = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--games N] [--seed S] [--max-ticks T] [--overlap-calls N] [--policy random|drop|greedy|autoplay] [--field-width W] [--field-height H] [--hidden-rows R] [--field-sweep] [--label name] [--out file.json]\n", argv[0]);
+			fprintf(stderr, "  --field-sweep   repeat the measurements on fields from 10x20 to 64x1000, games scaled down by field area\n");
+			return 1;
+		}
+	}
+
+	if (!Simulation::IsValidFieldSize(fieldSize))
+	{
+		fprintf(stderr, "Invalid field size %ux%u+%u\n", fieldSize.width, fieldSize.height, fieldSize.numHiddenRows);
+		return 1;
+	}
+
+	FieldSizeResult result;
+	MeasureFieldSize(fieldSize, numGames, seed, policy, maxTicksPerGame, numOverlapCalls, result);
+	const GamesResult& games = result.games;
+
+	// на больших полях партии длиннее: число партий уменьшаем пропорционально площади, чтобы замер шёл примерно одинаково
+	std::vector<FieldSizeResult> sweepResults;
+	if (bFieldSweep)
+	{
+		const FieldSize& baseFieldSize = s_sweepFieldSizes[0];
+		sweepResults.resize(s_kNumSweepFieldSizes);
+		for (unsigned int i = 0; i < s_kNumSweepFieldSizes; ++i)
+		{
+			const FieldSize& sweepFieldSize = s_sweepFieldSizes[i];
+			const unsigned long long area = (unsigned long long)sweepFieldSize.width * sweepFieldSize.height;
+			unsigned int numSweepGames = (unsigned int)((unsigned long long)numGames * baseFieldSize.width * baseFieldSize.height / area);
+			numSweepGames = numSweepGames > 0 ? numSweepGames : 1;
+			MeasureFieldSize(sweepFieldSize, numSweepGames, seed, policy, maxTicksPerGame, numOverlapCalls, sweepResults[i]);
+		}
+	}
+
+	FILE* pFile = pOutputPath ? fopen(pOutputPath, "w") : stdout;
+	if (!pFile)
+	{
+		fprintf(stderr, "Failed to open output file: %s\n", pOutputPath);
+		return 1;
+	}
+	fprintf(pFile, "{\n");
+	fprintf(pFile, "  \"label\": \"%s\",\n", pLabel);
+	fprintf(pFile, "  \"games\": %u,\n", numGames);
+	fprintf(pFile, "  \"seed\": %u,\n", seed);
+	fprintf(pFile, "  \"policy\": \"%s\",\n", s_inputPolicyNames[policy]);
+	fprintf(pFile, "  \"field_width\": %u,\n", fieldSize.width);
+	fprintf(pFile, "  \"field_height\": %u,\n", fieldSize.height);
+	fprintf(pFile, "  \"hidden_rows\": %u,\n", fieldSize.numHiddenRows);
+	fprintf(pFile, "  \"ticks\": %llu,\n", games.ticks);
+	fprintf(pFile, "  \"placements\": %llu,\n", games.placements);
+	fprintf(pFile, "  \"lines\": %llu,\n", games.lines);
+	fprintf(pFile, "  \"total_score\": %llu,\n", games.totalScore);
+	fprintf(pFile, "  \"seconds\": %.6f,\n", games.seconds);
+	fprintf(pFile, "  \"ticks_per_second\": %.1f,\n", games.seconds > 0.0 ? games.ticks / games.seconds : 0.0);
+	fprintf(pFile, "  \"placements_per_second\": %.1f,\n", games.seconds > 0.0 ? games.placements / games.seconds : 0.0);
+	fprintf(pFile, "  \"lines_per_second\": %.1f,\n", games.seconds > 0.0 ? games.lines / games.seconds : 0.0);
+	fprintf(pFile, "  \"ns_per_is_overlap\": %.3f,\n", result.nsPerIsOverlap);
+	fprintf(pFile, "  \"is_overlap_hit_rate\": %.4f,\n", result.numOverlapCalls ? (double)result.numOverlaps / result.numOverlapCalls : 0.0);
+	fprintf(pFile, "  \"ns_per_add_tetromino_to_field\": %.3f,\n", result.nsPerAddTetronimo);
+	fprintf(pFile, "  \"add_tetromino_samples\": %llu,\n", result.numAddPlacements);
+	fprintf(pFile, "  \"ns_per_new_game\": %.3f", result.nsPerNewGame);
+	if (bFieldSweep)
+	{
+		// по этим строкам видно, как время такта, фигуры и новой партии растёт с размером поля
+		fprintf(pFile, ",\n  \"field_sweep\": [\n");
+		for (unsigned int i = 0; i < s_kNumSweepFieldSizes; ++i)
+		{
+			const FieldSizeResult& sweep = sweepResults[i];
+			fprintf(pFile, "    { \"field_width\": %u, \"field_height\": %u, \"hidden_rows\": %u, \"games\": %u, \"ticks\": %llu, \"placements\": %llu, "
+				"\"lines\": %llu, \"ns_per_tick\": %.3f, \"ns_per_placement\": %.3f, \"ns_per_is_overlap\": %.3f, "
+				"\"ns_per_add_tetromino_to_field\": %.3f, \"ns_per_new_game\": %.3f }%s\n",
+				sweep.fieldSize.width, sweep.fieldSize.height, sweep.fieldSize.numHiddenRows, sweep.numGames, sweep.games.ticks,
+				sweep.games.placements, sweep.games.lines, sweep.games.ticks ? sweep.games.seconds * 1e9 / sweep.games.ticks : 0.0,
+				sweep.games.placements ? sweep.games.seconds * 1e9 / sweep.games.placements : 0.0, sweep.nsPerIsOverlap,
+				sweep.nsPerAddTetronimo, sweep.nsPerNewGame, i + 1 < s_kNumSweepFieldSizes ? "," : "");
+		}
+		fprintf(pFile, "  ]");
+	}
+	fprintf(pFile, "\n}\n");
+	if (pFile != stdout)
+	{
+		fclose(pFile);
+	}
+	return 0;
+}
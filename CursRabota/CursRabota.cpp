@@ -1,39 +1,150 @@
 ﻿
 
 #include "App.h"
+#include "Simulation.h"
 
 #include "SDL.h"
 #include "locale.h""ё
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 int main(int argc, char** argv)
 {
 	setlocale(LC_ALL, "Rus");
-	bool bFullScreen = false;
-	unsigned int displayWidth = 1280;
-	unsigned int displayHeight = 720;
+	AppOptions options;
+	options.bFullScreen = false;
+	options.displayWidth = 1280;
+	options.displayHeight = 720;
+	options.seed = (unsigned int)time(NULL);
+	options.pRecordPath = nullptr;
+	options.bAutoplay = false;
+	options.aiSearchDepth = 1;
+	options.aiBeamWidth = 1;
+	options.aiTableMegabytes = 16;
+	options.autoShiftDelayMs = Simulation::kDefaultAutoShiftDelayMs;
+	options.autoRepeatMs = Simulation::kDefaultAutoRepeatMs;
+	options.fieldSize = Simulation::GetDefaultFieldSize();
+	options.bVsync = true;
+	options.fpsCap = 0;
+	options.bIdle = true;
+	options.bLowLatency = false;
+	options.bInputThread = false;
+	options.bRenderThread = false;
+	options.pProfileCsvPath = nullptr;
+	options.pTracePath = nullptr;
 	for (int i = 1; i < argc; ++i)
 	{
 		if (strcmp(argv[i], "--fullscreen") == 0)
 		{
-			bFullScreen = true;
+			options.bFullScreen = true;
 		}
 		else if (strcmp(argv[i], "--width") == 0)
 		{
 			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
-			displayWidth = (unsigned int)atoi(argv[++i]);
+			options.displayWidth = (unsigned int)atoi(argv[++i]);
 		}
 		else if (strcmp(argv[i], "--height") == 0)
 		{
 			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
-			displayHeight = (unsigned int)atoi(argv[++i]);
+			options.displayHeight = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0)
+		{
+			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
+			options.seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--record") == 0)
+		{
+			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
+			options.pRecordPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--autoplay") == 0)
+		{
+			options.bAutoplay = true;
+		}
+		else if (strcmp(argv[i], "--ai-depth") == 0)
+		{
+			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
+			options.aiSearchDepth = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--ai-beam") == 0)
+		{
+			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
+			options.aiBeamWidth = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--ai-tt-mb") == 0)
+		{
+			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
+			options.aiTableMegabytes = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--das") == 0)
+		{
+			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
+			options.autoShiftDelayMs = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--arr") == 0)
+		{
+			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
+			options.autoRepeatMs = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--field-width") == 0)
+		{
+			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
+			options.fieldSize.width = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--field-height") == 0)
+		{
+			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
+			options.fieldSize.height = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--hidden-rows") == 0)
+		{
+			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
+			options.fieldSize.numHiddenRows = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--fps-cap") == 0)
+		{
+			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
+			options.fpsCap = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--no-vsync") == 0)
+		{
+			options.bVsync = false;
+		}
+		else if (strcmp(argv[i], "--no-idle") == 0)
+		{
+			options.bIdle = false;
+		}
+		else if (strcmp(argv[i], "--low-latency") == 0)
+		{
+			options.bLowLatency = true;
+		}
+		else if (strcmp(argv[i], "--input-thread") == 0)
+		{
+			options.bInputThread = true;
+		}
+		else if (strcmp(argv[i], "--render-thread") == 0)
+		{
+			options.bRenderThread = true;
+		}
+		else if (strcmp(argv[i], "--profile-csv") == 0)
+		{
+			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
+			options.pProfileCsvPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--trace") == 0)
+		{
+			SDL_assert(argc > i); // убеждаемся, что у нас есть аргумент 
+			options.pTracePath = argv[++i];
 		}
 	}
 
+	printf("Seed = %u\n", options.seed);	// с этим зерном партию можно повторить
+
 	App app;
-	if (!app.Init(bFullScreen, displayWidth, displayHeight))
+	if (!app.Init(options))
 	{
 		printf("Ошибка! НЕ получилось инициализировать игру\n");
 		app.ShutDown();
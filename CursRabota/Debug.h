@@ -1,6 +1,6 @@
 #ifndef DEBUG_H
 #define DEBUG_H
-//  ,         
+// класс отладчик, которую используют для првоерки и отладки выполняемых файлов 
 #define HP_UNUSED(X)	(void)X
 
 #if defined _MSC_VER
@@ -31,4 +31,23 @@
 	fprintf( stderr, "FATAL ERROR: %s\nFile:\t%s\nLine:\t%d\n\n", #message, __FILE__, __LINE__ ); \
 	HP_BREAK
 
+// Трассировка для Chrome / Perfetto (chrome://tracing, ui.perfetto.dev). Включается определением HP_TRACE_ENABLED,
+// без него макросы раскрываются в пустоту и ничего не стоят
+#ifdef HP_TRACE_ENABLED
+#include "Trace.h"
+#define HP_TRACE_CONCAT_IMPL( a, b )	a##b
+#define HP_TRACE_CONCAT( a, b )			HP_TRACE_CONCAT_IMPL( a, b )
+#define HP_TRACE_SCOPE( name )			TraceScope HP_TRACE_CONCAT( traceScope_, __LINE__ )( name )
+#define HP_TRACE_BEGIN( name )			Trace::Begin( name )
+#define HP_TRACE_END()					Trace::End()
+#define HP_TRACE_THREAD_NAME( name )	Trace::SetThreadName( name )
+#define HP_TRACE_WRITE( path )			Trace::WriteJson( path )
+#else
+#define HP_TRACE_SCOPE( name )
+#define HP_TRACE_BEGIN( name )
+#define HP_TRACE_END()
+#define HP_TRACE_THREAD_NAME( name )
+#define HP_TRACE_WRITE( path )
+#endif
+
 #endif // DEBUG_H
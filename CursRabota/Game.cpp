@@ -11,161 +11,82 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
 #include <locale.h>
-static const unsigned int s_kFieldWidth = 10;
-static const unsigned int s_kFieldHeight = 20;
-//static const unsigned int s_kNumHiddenRows = 2;		
-static const unsigned int s_initialFramesPerFallStep = 48;
-static const int s_deltaFramesPerFallStepPerLevel = 2;
+#include <algorithm>
 
-//--------------------------------------------------------------------------------------------------
-
-static const Tetromino s_tetrominos[kNumTetrominoTypes] =
-{
-	// I
-	{
-		0, 1, 1, 1, 2, 1, 3, 1,
-		2, 0, 2, 1, 2, 2, 2, 3,
-		0, 2, 1, 2, 2, 2, 3, 2,
-		1, 0, 1, 1, 1, 2, 1, 3,
-		0x00ffffff,
-	},
-	// J
-	{
-		0, 0, 0, 1, 1, 1, 2, 1,
-		1, 0, 2, 0, 1, 1, 1, 2,
-		0, 1, 1, 1, 2, 1, 2, 2,
-		1, 0, 1, 1, 0, 2, 1, 2,
-		0x0000ffff,
-	},
-	// L
-	{
-		2, 0, 0, 1, 1, 1, 2, 1,
-		1, 0, 1, 1, 1, 2, 2, 2,
-		0, 1, 1, 1, 2, 1, 0, 2,
-		0, 0, 1, 0, 1, 1, 1, 2,
-		0xffaa00ff,
-	},
-	// O
-	{
-		1, 0, 2, 0, 1, 1, 2, 1,
-		1, 0, 2, 0, 1, 1, 2, 1,
-		1, 0, 2, 0, 1, 1, 2, 1,
-		1, 0, 2, 0, 1, 1, 2, 1,
-		0xffff00ff
-	},
-	// S
-	{
-		1, 0, 2, 0, 0, 1, 1, 1,
-		1, 0, 1, 1, 2, 1, 2, 2,
-		1, 1, 2, 1, 0, 2, 1, 2,
-		0, 0, 0, 1, 1, 1, 1, 2,
-		0x00ff00ff,
-	},
-	// T
-	{
-		1, 0, 0, 1, 1, 1, 2, 1,
-		1, 0, 1, 1, 2, 1, 1, 2,
-		0, 1, 1, 1, 2, 1, 1, 2,
-		1, 0, 0, 1, 1, 1, 1, 2,
-		0x9900ffff,
-	},
-	// Z
-	{
-		0, 0, 1, 0, 1, 1, 2, 1,
-		2, 0, 1, 1, 2, 1, 1, 2,
-		0, 1, 1, 1, 1, 2, 2, 2,
-		1, 0, 0, 1, 1, 1, 0, 2,
-		0xff0000ff,
-	}
-};
+static const float s_kTickSeconds = 1.0f / (float)Simulation::kTicksPerSecond;
+static const float s_kMaxFrameSeconds = 0.25f;	// после долгой паузы (перетаскивание окна, отладчик) не догоняем больше этого
 
 //--------------------------------------------------------------------------------------------------
-
-static bool IsOverlap(const TetrominoInstance& tetronimoInstance, const Field& field)
-{
-	const Tetromino& tetronimo = s_tetrominos[tetronimoInstance.m_tetrominoType];
-	const Tetromino::BlockCoords& blockCoords = tetronimo.blockCoord[tetronimoInstance.m_rotation];
-	for (unsigned int i = 0; i < Tetromino::kNumBlocks; ++i)
-	{
-		const int x = tetronimoInstance.m_pos.x + blockCoords[i].x;
-		const int y = tetronimoInstance.m_pos.y + blockCoords[i].y;
-
-		//      
-		if (x < 0 || x >= (int)field.width || y < 0 || y >= (int)field.height)
-			return true;
-
-		if (field.staticBlocks[x + y * field.width] != -1)
-			return true;
-	}
-
-	return false;
-}
-
-static void SetBlock(Field& field, unsigned int ix, unsigned int iy, unsigned int val)
-{
-	HP_ASSERT(ix < field.width);
-	HP_ASSERT(iy < field.height);
-	field.staticBlocks[iy * field.width + ix] = val;
-}
-
-//--------------------------------------------------------------------------------------------------
-//     
+// обнуляем параметры в конструкторе 
 Game::Game()
 	: m_deltaTimeSeconds(0.0f)
-	, m_framesUntilFall(s_initialFramesPerFallStep)
-	, m_framesPerFallStep(s_initialFramesPerFallStep)
-	, m_numUserDropsForThisTetronimo(0)
-	, m_numLinesCleared(0)
-	, m_level(0)
-	, m_score(0)
+	, m_tickAccumulatorSeconds(0.0f)
+	, m_pendingInputBits(0)
+	, m_bHoldLeft(false)
+	, m_bHoldRight(false)
+	, m_pTimedInputs(nullptr)
+	, m_numTimedInputs(0)
+	, m_numTimedInputsTaken(0)
+	, m_frameTimeMicroseconds(0)
 	, m_hiScore(0)
+	, m_seed(0)
+	, m_numGamesStarted(0)
+	, m_bAutoplay(false)
 	, m_gameState(kGameState_TitleScreen)
+	, m_bShowGhost(true)
+	, m_pFieldTexture(nullptr)
+	, m_fieldTextureWidth(0)
+	, m_fieldTextureHeight(0)
+	, m_fieldTextureGeneration(0)
+	, m_bFieldTextureValid(false)
+	, m_bFieldTextureFailed(false)
 {
-	m_field.staticBlocks = nullptr;
 }
 
 Game::~Game()
 {
 }
 
-bool Game::Init()
+bool Game::Init(unsigned int seed, const char* pRecordPath, const AutoPlayer::Settings* pAutoplaySettings)
 {
+	m_seed = seed;
+	m_recordPath = pRecordPath ? pRecordPath : "";
+	m_bAutoplay = pAutoplaySettings != nullptr;
+	if (pAutoplaySettings)
+	{
+		m_autoPlayer.Configure(*pAutoplaySettings);
+	}
+	m_numGamesStarted = 0;
 	return true;
 }
 
 void Game::Shutdown()
 {
-	delete[] m_field.staticBlocks;
-	m_field.staticBlocks = nullptr;
-}
-
-void Game::Reset()
-{
-	/*  */
-}
-
-//  true,      
-bool Game::SpawnTetronimo()
-{
-	m_activeTetromino.m_tetrominoType = (TetrominoType)(rand() % kNumTetrominoTypes);
-	m_activeTetromino.m_rotation = 0;
-	m_activeTetromino.m_pos.x = (m_field.width - 4) / 2;	//   tetronimo  = 4
-	m_activeTetromino.m_pos.y = 0;
+	if (m_bAutoplay)
+	{
+		const TranspositionTable::Stats tableStats = m_autoPlayer.GetTranspositionTableStats();
+		printf("Autoplay: %llu searches, %.1f us avg, %.1f us max; table %.1f MB, hit rate %.3f\n", m_autoPlayer.GetNumSearches(),
+			m_autoPlayer.GetNumSearches() ? m_autoPlayer.GetSearchSeconds() * 1e6 / m_autoPlayer.GetNumSearches() : 0.0,
+			m_autoPlayer.GetMaxSearchSeconds() * 1e6, tableStats.memoryBytes / (1024.0 * 1024.0),
+			tableStats.numProbes ? (double)tableStats.numHits / tableStats.numProbes : 0.0);
+	}
 
-	if (IsOverlap(m_activeTetromino, m_field))
+	// партия не доиграна - сохраняем то, что успели записать
+	if (m_replayRecorder.IsRecording())
 	{
-		return false;
+		m_replayRecorder.Save(m_recordPath.c_str());
 	}
+}
 
-	m_framesUntilFall = s_initialFramesPerFallStep;
-	m_numUserDropsForThisTetronimo = 0;
-	return true;
+void Game::Reset()
+{
+	/* не потребовалс*/
 }
 
 void Game::Update(const GameInput& gameInput, float deltaTimeSeconds)
 {
+	HP_TRACE_SCOPE("Game::Update");
 	m_deltaTimeSeconds = deltaTimeSeconds;
 
 	switch (m_gameState)
@@ -189,8 +110,55 @@ void Game::Update(const GameInput& gameInput, float deltaTimeSeconds)
 		break;
 	case kGameState_Playing:
 	{
-		UpdatePlaying(gameInput);
-		if (gameInput.bPause)
+		if (gameInput.bToggleGhost)
+			m_bShowGhost = !m_bShowGhost;
+
+		if (!m_pTimedInputs)
+		{
+			// зажатие - состояние на момент опроса ввода, оно одинаково для всех тактов кадра
+			m_pendingInputBits |= PackGameInput(gameInput);
+			m_bHoldLeft = gameInput.bHoldLeft;
+			m_bHoldRight = gameInput.bHoldRight;
+		}
+		m_tickAccumulatorSeconds += deltaTimeSeconds < s_kMaxFrameSeconds ? deltaTimeSeconds : s_kMaxFrameSeconds;
+		while (m_tickAccumulatorSeconds >= s_kTickSeconds && !m_simulation.IsGameOver())
+		{
+			m_tickAccumulatorSeconds -= s_kTickSeconds;
+			if (m_pTimedInputs)
+			{
+				// такт заканчивается за остаток накопителя до момента кадра
+				TakeTimedInputs(m_frameTimeMicroseconds - (long long)(m_tickAccumulatorSeconds * 1000000.0f));
+			}
+
+			GameInput tickInput;
+			UnpackGameInput(m_pendingInputBits, tickInput);
+			m_pendingInputBits = 0;
+			tickInput.bHoldLeft = m_bHoldLeft;
+			tickInput.bHoldRight = m_bHoldRight;
+			if (m_bAutoplay)
+			{
+				m_autoPlayer.MakeInput(m_simulation, tickInput);
+			}
+
+			m_simulation.Update(tickInput);
+			m_replayRecorder.AddFrame(tickInput);
+		}
+		if (m_pTimedInputs)
+		{
+			TakeTimedInputs(m_frameTimeMicroseconds);	// пришедшее после последнего такта ждёт следующего
+		}
+		if (m_simulation.GetScore() > m_hiScore)
+			m_hiScore = m_simulation.GetScore();
+
+		if (m_simulation.IsGameOver())
+		{
+			if (m_replayRecorder.IsRecording())
+			{
+				m_replayRecorder.Save(m_recordPath.c_str());
+			}
+			m_gameState = kGameState_GameOver;
+		}
+		else if (gameInput.bPause)
 			m_gameState = kGamePause;
 		break;
 	}
@@ -229,314 +197,153 @@ void Game::Update(const GameInput& gameInput, float deltaTimeSeconds)
 	}
 }
 
-void Game::InitPlaying()
+void Game::UpdateTimed(const GameInput& gameInput, const InputRecord* pRecords, unsigned int numRecords,
+	long long frameTimeMicroseconds, float deltaTimeSeconds)
 {
-	m_field.width = s_kFieldWidth;
-	m_field.height = s_kFieldHeight;
-	delete[] m_field.staticBlocks;
-	m_field.staticBlocks = new int[m_field.width * m_field.height];
-
-	for (unsigned int iy = 0; iy < m_field.height; ++iy)
-	{
-		for (unsigned int ix = 0; ix < m_field.width; ++ix)
-		{
-			m_field.staticBlocks[iy * m_field.width + ix] = -1;
-		}
-	}
-
-	srand((unsigned int)time(NULL));
-
-	SpawnTetronimo(); //     ()
-
-	m_numLinesCleared = 0;
-	m_level = 0;
-	m_framesPerFallStep = s_initialFramesPerFallStep;
-	m_score = 0;
+	m_pTimedInputs = pRecords;
+	m_numTimedInputs = numRecords;
+	m_numTimedInputsTaken = 0;
+	m_frameTimeMicroseconds = frameTimeMicroseconds;
+	Update(gameInput, deltaTimeSeconds);
+	m_pTimedInputs = nullptr;
+	m_numTimedInputs = 0;
 }
 
-
-//     
-void Game::UpdatePlaying(const GameInput& gameInput)
+// ввод, пришедший не позже untilMicroseconds, - в ближайший такт
+void Game::TakeTimedInputs(long long untilMicroseconds)
 {
-#ifdef _DEBUG
-	if (gameInput.bDebugChangeTetromino)
-	{
-		m_activeTetromino.m_tetrominoType = (TetrominoType)(((unsigned int)m_activeTetromino.m_tetrominoType + 1) % (unsigned int)kNumTetrominoTypes);
-	}
-	if (gameInput.bDebugMoveLeft)
-	{
-		--m_activeTetromino.m_pos.x;
-	}
-	if (gameInput.bDebugMoveRight)
-	{
-		++m_activeTetromino.m_pos.x;
-	}
-	if (gameInput.bDebugMoveUp)
-	{
-		--m_activeTetromino.m_pos.y;
-	}
-	if (gameInput.bDebugMoveDown)
-	{
-		++m_activeTetromino.m_pos.y;
-	}
-#endif
-
-	//   
-	if (gameInput.bMoveLeft)
-	{
-		// 
-		TetrominoInstance testInstance = m_activeTetromino;
-		--testInstance.m_pos.x;
-		if (!IsOverlap(testInstance, m_field))
-			m_activeTetromino.m_pos.x = testInstance.m_pos.x;
-	}
-	if (gameInput.bMoveRight)
-	{
-		// 
-		TetrominoInstance testInstance = m_activeTetromino;
-		++testInstance.m_pos.x;
-		if (!IsOverlap(testInstance, m_field))
-			m_activeTetromino.m_pos.x = testInstance.m_pos.x;
-	}
-
-
-	//  
-	if (gameInput.bRotateClockwise)
-	{
-		TetrominoInstance testInstance = m_activeTetromino;
-		if (testInstance.m_rotation == 0)
-		{
-			testInstance.m_rotation = 3;
-		}
-		else
-		{
-			--testInstance.m_rotation;
-		}
-
-		//   
-		if (IsOverlap(testInstance, m_field))
-		{
-			//    ,  1   1 
-			testInstance.m_pos.x = m_activeTetromino.m_pos.x - 1;
-			if (!IsOverlap(testInstance, m_field))
-			{
-				m_activeTetromino = testInstance;
-			}
-			else
-			{
-				testInstance.m_pos.x = m_activeTetromino.m_pos.x + 1;
-				if (!IsOverlap(testInstance, m_field))
-				{
-					m_activeTetromino = testInstance;
-				}
-			}
-		}
-		else
-		{
-			//  
-			m_activeTetromino = testInstance;
-		}
-	}
-
-	if (gameInput.bRotateAnticlockwise)
+	while (m_numTimedInputsTaken < m_numTimedInputs && m_pTimedInputs[m_numTimedInputsTaken].timeMicroseconds <= untilMicroseconds)
 	{
-		m_activeTetromino.m_rotation = (m_activeTetromino.m_rotation + 1) % Tetromino::kNumRotations;
-	}
-
-	//  
-	m_framesUntilFall -= 1;
-	if (m_framesUntilFall <= 0)
-	{
-		m_framesUntilFall = m_framesPerFallStep;
-
-		//   
-		TetrominoInstance testInstance = m_activeTetromino;
-		testInstance.m_pos.y += 1;
-		if (IsOverlap(testInstance, m_field))
-		{
-			AddTetronimoToField(m_field, m_activeTetromino);
-			if (!SpawnTetronimo())
-				m_gameState = kGameState_GameOver;
-		}
-		else
-		{
-			m_activeTetromino.m_pos.y = testInstance.m_pos.y;
-		}
+		const InputRecord& record = m_pTimedInputs[m_numTimedInputsTaken++];
+		m_pendingInputBits |= PackGameInput(record.gameInput);
+		m_bHoldLeft = record.gameInput.bHoldLeft;
+		m_bHoldRight = record.gameInput.bHoldRight;
 	}
+}
 
-	//   ()
-	if (gameInput.bSoftDrop)
-	{
-		//   
-		TetrominoInstance testInstance = m_activeTetromino;
-		++testInstance.m_pos.y;
-		if (!IsOverlap(testInstance, m_field))
-		{
-			m_activeTetromino.m_pos.y = testInstance.m_pos.y;
-			++m_numUserDropsForThisTetronimo;
-		}
-	}
+void Game::InitPlaying()
+{
+	m_tickAccumulatorSeconds = 0.0f;
+	m_pendingInputBits = 0;
 
-	//   
-	if (gameInput.bHardDrop)
+	const unsigned int seed = m_seed + m_numGamesStarted;
+	++m_numGamesStarted;
+	m_simulation.NewGame(seed);
+	m_autoPlayer.Reset();
+	if (!m_recordPath.empty())
 	{
-		TetrominoInstance testInstance = m_activeTetromino;
-		while (!IsOverlap(testInstance, m_field))
-		{
-			++testInstance.m_pos.y;
-			++m_numUserDropsForThisTetronimo;
-		}
-		--testInstance.m_pos.y;	//   
-		--m_numUserDropsForThisTetronimo;
-		AddTetronimoToField(m_field, testInstance);
-		if (!SpawnTetronimo())
-			m_gameState = kGameState_GameOver;
+		m_replayRecorder.Begin(seed, m_simulation.GetAutoShiftDelayMs(), m_simulation.GetAutoRepeatMs(), m_simulation.GetFieldSize());	// каждая новая партия перезаписывает файл
 	}
-	
 }
 
-void Game::AddTetronimoToField(const Field& field, const TetrominoInstance& tetronimoInstance)
+//наслед
+void Game::Draw(Renderer& renderer)
 {
-	const Tetromino& tetronimo = s_tetrominos[tetronimoInstance.m_tetrominoType];
-	const Tetromino::BlockCoords& blockCoords = tetronimo.blockCoord[tetronimoInstance.m_rotation];
-	for (unsigned int i = 0; i < Tetromino::kNumBlocks; ++i)
-	{
-		const int x = tetronimoInstance.m_pos.x + blockCoords[i].x;
-		const int y = tetronimoInstance.m_pos.y + blockCoords[i].y;
-
-		//      -- 
-		HP_ASSERT((x >= 0) && (x < (int)field.width) && (y >= 0) && (y < (int)field.height))
+	WriteSnapshot(m_drawSnapshot);
+	Draw(renderer, m_drawSnapshot, m_deltaTimeSeconds);
+}
 
-			field.staticBlocks[x + y * field.width] = (unsigned int)tetronimoInstance.m_tetrominoType;
-	}
+void Game::WriteSnapshot(GameSnapshot& snapshot) const
+{
+	HP_TRACE_SCOPE("Game::WriteSnapshot");
+	snapshot.gameState = (unsigned int)m_gameState;
+	snapshot.hiScore = m_hiScore;
+	snapshot.numLinesCleared = m_simulation.GetNumLinesCleared();
+	snapshot.level = m_simulation.GetLevel();
+	snapshot.score = m_simulation.GetScore();
+	snapshot.ticksPerFallStep = m_simulation.GetTicksPerFallStep();
 
-	//     
-	unsigned int numLinesCleared = 0;
-	for (unsigned int y = 0; y < field.height; ++y)
+	// клетки копируем только в строках, изменившихся с прошлой записи этого снимка
+	const Field& field = m_simulation.GetField();
+	const bool bResized = snapshot.fieldWidth != field.width || snapshot.fieldHeight != field.height
+		|| snapshot.fieldNumHiddenRows != field.numHiddenRows;
+	if (bResized)
 	{
-		bool bRowFull = true;
-		for (unsigned int x = 0; x < field.width; ++x)
-		{
-			if (field.staticBlocks[x + y * field.width] == -1)
-			{
-				bRowFull = false;
-				break;
-			}
-		}
-
-		if (bRowFull)
-		{
-			++numLinesCleared;
-
-			//      
-			for (unsigned int yy = y; yy > 0; --yy)
-			{
-				for (unsigned int x = 0; x < field.width; ++x)
-				{
-					field.staticBlocks[x + yy * field.width] = field.staticBlocks[x + (yy - 1) * field.width];
-				}
-			}
-		}
+		snapshot.fieldWidth = field.width;
+		snapshot.fieldHeight = field.height;
+		snapshot.fieldNumHiddenRows = field.numHiddenRows;
+		snapshot.staticBlocks.resize(field.width * field.height);
+		snapshot.rowRevisions.resize(field.height);
 	}
-
-	unsigned int previousLevel = m_numLinesCleared / 10;
-	m_numLinesCleared += numLinesCleared;
-	m_level = m_numLinesCleared / 10;
-
-	if (m_level != previousLevel)
+	for (unsigned int iy = 0; iy < field.height; ++iy)
 	{
-		//  
-		m_framesPerFallStep -= s_deltaFramesPerFallStepPerLevel;
-		if (m_framesPerFallStep < 1)
-		{
-			m_framesPerFallStep = 1;
-		}
+		const unsigned int rowRevision = m_simulation.GetRowRevision(iy);
+		if (!bResized && snapshot.rowRevisions[iy] == rowRevision)
+			continue;
+
+		const int* pRow = field.staticBlocks + iy * field.width;
+		std::copy(pRow, pRow + field.width, snapshot.staticBlocks.begin() + iy * field.width);
+		snapshot.rowRevisions[iy] = rowRevision;
 	}
 
-	// 
-	if (numLinesCleared > 0)
+	snapshot.activeTetromino = m_simulation.GetActiveTetromino();
+	for (unsigned int i = 0; i < Simulation::kNumNextTetrominos; ++i)
 	{
-		unsigned int multiplier = 0;
-		switch (numLinesCleared)
-		{
-		case 1:
-			multiplier = 40;
-			break;
-		case 2:
-			multiplier = 100;
-			break;
-		case 3:
-			multiplier = 300;
-			break;
-		case 4:
-			multiplier = 1200;
-		}
-
-		unsigned int score = multiplier * (previousLevel + 1);
-		score += m_numUserDropsForThisTetronimo;
-		m_score += score;
-		if (m_score > m_hiScore)
-			m_hiScore = m_score;
+		snapshot.nextTetrominos[i] = m_simulation.GetNextTetromino(i);
 	}
+	// тень считается здесь: для неё нужны маски строк, которых в снимке нет
+	snapshot.ghostDropDistance = m_bShowGhost && field.width > 0 ? Simulation::GetDropDistance(snapshot.activeTetromino, field) : 0;
 
+	snapshot.bAutoplay = m_bAutoplay;
+	snapshot.autoplaySearchSeconds = (float)m_autoPlayer.GetLastSearchSeconds();
 }
 
-//
-void Game::Draw(Renderer& renderer)
+void Game::Draw(Renderer& renderer, const GameSnapshot& snapshot, float frameSeconds)
 {
+	HP_TRACE_SCOPE("Game::Draw");
 	//setlocale(LC_ALL, "Rus");
-	switch (m_gameState)
+	switch ((GameState)snapshot.gameState)
 	{
-	case kGameState_TitleScreen: //
+	case kGameState_TitleScreen: //МЕНЮ
 		char text[128];
-		renderer.DrawText(" ,    ", renderer.GetLogicalWidth() / 3.5 - 50, renderer.GetLogicalHeight() / 3.3, 0xffffffff);
-		renderer.DrawText(" ESC, ", renderer.GetLogicalWidth() / 3.5 - 50, renderer.GetLogicalHeight() / 2, 0xffffffff);
-		renderer.DrawText(" H,    ", renderer.GetLogicalWidth() / 3.5 - 50, renderer.GetLogicalHeight() / 2.5, 0xffffffff);
-		renderer.DrawText(" R,   ", renderer.GetLogicalWidth() / 3.5 - 50, renderer.GetLogicalHeight() / 2.8, 0xffffffff);
+		renderer.DrawText("Нажимте ПРОБЕЛ,чтобы начать игру  ", renderer.GetLogicalWidth() / 3.5 - 50, renderer.GetLogicalHeight() / 3.3, 0xffffffff);
+		renderer.DrawText("Нажмите ESC,чтобы выйти", renderer.GetLogicalWidth() / 3.5 - 50, renderer.GetLogicalHeight() / 2, 0xffffffff);
+		renderer.DrawText("Нажмите H, чтобы посмотреть лучший счёт", renderer.GetLogicalWidth() / 3.5 - 50, renderer.GetLogicalHeight() / 2.5, 0xffffffff);
+		renderer.DrawText("Нажмите R, чтобы посмотреть правила", renderer.GetLogicalWidth() / 3.5 - 50, renderer.GetLogicalHeight() / 2.8, 0xffffffff);
 
-		renderer.DrawText(" -   507 ", renderer.GetLogicalWidth() / 2.1 - 50, renderer.GetLogicalHeight() / 1.2, 0xffffffff);
+		renderer.DrawText("Выполнил - Лукашев Михаил И507Б ", renderer.GetLogicalWidth() / 2.1 - 50, renderer.GetLogicalHeight() / 1.2, 0xffffffff);
 
 		break;
 	case kGameState_Playing:
-		DrawPlaying(renderer);
+		DrawPlaying(renderer, snapshot);
 		break;
 	case kGameState_GameOver:
-		DrawPlaying(renderer);
-		renderer.DrawText(" ", renderer.GetLogicalWidth() / 2 - 100, renderer.GetLogicalHeight() / 2, 0xffffffff);
+		DrawPlaying(renderer, snapshot);
+		renderer.DrawText("ИГРА ОКОНЧЕНА", renderer.GetLogicalWidth() / 2 - 100, renderer.GetLogicalHeight() / 2, 0xffffffff);
 		
-		snprintf(text, sizeof(text), " -    ", m_framesPerFallStep);
+		snprintf(text, sizeof(text), "ПРОБЕЛ - ВЕРНУТСЯ В МЕНЮ ", snapshot.ticksPerFallStep);
 		renderer.DrawText(text, 0, 300, 0x404040ff);
 		break;
 	case kNumGameStates :
 	{
 		char text[128];
-		snprintf(text, sizeof(text), " : %u", m_hiScore); //     
+		snprintf(text, sizeof(text), "Лучший счёт: %u", snapshot.hiScore); //добавить в меню пункт с просмотром
 		renderer.DrawText(text, renderer.GetLogicalWidth() / 2.5 - 50, renderer.GetLogicalHeight() / 2.5, 0xffffffff);
-		snprintf(text, sizeof(text), " -  ", m_framesPerFallStep);
+		snprintf(text, sizeof(text), "ПРОБЕЛ - НАЗАД ", snapshot.ticksPerFallStep);
 		renderer.DrawText(text, 0, 400, 0x404040ff);
 		break;
 	}
 	case kGamePause :
 	{
-		DrawPlaying(renderer);
-		renderer.DrawText("", renderer.GetLogicalWidth() / 2 - 100, renderer.GetLogicalHeight() / 2, 0xffffffff);
+		DrawPlaying(renderer, snapshot);
+		renderer.DrawText("ПАУЗА", renderer.GetLogicalWidth() / 2 - 100, renderer.GetLogicalHeight() / 2, 0xffffffff);
 		char text[128];
-		snprintf(text, sizeof(text), " -  ", m_framesPerFallStep);
+		snprintf(text, sizeof(text), "ПРОБЕЛ - ПРОДОЛЖИТЬ ", snapshot.ticksPerFallStep);
 		renderer.DrawText(text, 0, 300, 0x404040ff);
 		break;
 	}
 	case kGameRules:
 	{
 		char text[128];
-		snprintf(text, sizeof(text), "", m_framesPerFallStep);
+		snprintf(text, sizeof(text), "Правила", snapshot.ticksPerFallStep);
 		renderer.DrawText(text,500, 100, 0xffffffff);
-		renderer.DrawText("    ,    -   ", renderer.GetLogicalWidth() / 2 - 635, renderer.GetLogicalHeight() / 3.5, 0xffffffff);
-		renderer.DrawText("   - ,    ", renderer.GetLogicalWidth() / 2 - 635, renderer.GetLogicalHeight() / 3.1, 0xffffffff);
-		renderer.DrawText("     ,       ", renderer.GetLogicalWidth() / 2 - 635, renderer.GetLogicalHeight() / 2.7, 0xffffffff);
-		renderer.DrawText("      -   ", renderer.GetLogicalWidth() / 2 - 635, renderer.GetLogicalHeight() / 2.4, 0xffffffff);
-		renderer.DrawText("          ", renderer.GetLogicalWidth() / 2 - 635, renderer.GetLogicalHeight() / 2.2, 0xffffffff);
-		renderer.DrawText(" ! ", renderer.GetLogicalWidth() / 2 - 190, renderer.GetLogicalHeight() / 1.5, 0xffffffff);
-		snprintf(text, sizeof(text), " - ", m_framesPerFallStep);
+		renderer.DrawText("Собирайте целые линии из фигур, чем больше линий - тем больше очков", renderer.GetLogicalWidth() / 2 - 635, renderer.GetLogicalHeight() / 3.5, 0xffffffff);
+		renderer.DrawText("Выстроенная полностью линия - исчезает, Вам начисляются очки ", renderer.GetLogicalWidth() / 2 - 635, renderer.GetLogicalHeight() / 3.1, 0xffffffff);
+		renderer.DrawText("Игра не завершится до тех пор, пока на поле есть свободное место ", renderer.GetLogicalWidth() / 2 - 635, renderer.GetLogicalHeight() / 2.7, 0xffffffff);
+		renderer.DrawText("Если свободного места для фигуры нет - Вы проиграли ", renderer.GetLogicalWidth() / 2 - 635, renderer.GetLogicalHeight() / 2.4, 0xffffffff);
+		renderer.DrawText("Ваш лучиший счёт будет записан и его можно будет посмотреть ", renderer.GetLogicalWidth() / 2 - 635, renderer.GetLogicalHeight() / 2.2, 0xffffffff);
+		renderer.DrawText("Приятной Игры! ", renderer.GetLogicalWidth() / 2 - 190, renderer.GetLogicalHeight() / 1.5, 0xffffffff);
+		snprintf(text, sizeof(text), "ПРОБЕЛ - НАЗАД", snapshot.ticksPerFallStep);
 		renderer.DrawText(text, 0, 400, 0x404040ff);
 		break;
 	}
@@ -545,82 +352,211 @@ void Game::Draw(Renderer& renderer)
 	}
 
 	//#ifdef _DEBUG
-	//   
-	float fps = 1.0f / m_deltaTimeSeconds;
+	//трекер кадров в секунду
+	float fps = 1.0f / frameSeconds;
 	char text[128];
 	snprintf(text, sizeof(text), "FPS: %.1f", fps);
-	renderer.DrawText(text, 0, 0, 0x8080ffff);
+	renderer.DrawDynamicText(text, 0, 0, 0x8080ffff);
 	//#endif
 }
-//      
-void Game::DrawPlaying(Renderer& renderer)
+// метод рисования во время игры 
+void Game::DrawPlaying(Renderer& renderer, const GameSnapshot& snapshot)
 {
-	static unsigned int blockSizePixels = 32;
+	HP_TRACE_SCOPE("Game::DrawPlaying");
+	static const unsigned int s_kMaxBlockSizePixels = 32;
 
-	//	
+	const TetrominoInstance& activeTetromino = snapshot.activeTetromino;
 
-	unsigned int fieldWidthPixels = m_field.width * blockSizePixels;
-	unsigned int fieldHeightPixels = m_field.height * blockSizePixels;
+	//Поле	
 
-	unsigned int fieldOffsetPixelsX = 0;
+	// скрытые строки сверху не рисуются; большое поле рисуется мельче, чтобы поместиться на экран
+	const unsigned int numHiddenRows = snapshot.fieldNumHiddenRows;
+	const unsigned int numVisibleRows = snapshot.fieldHeight - numHiddenRows;
+	unsigned int blockSizePixels = s_kMaxBlockSizePixels;
+	if (numVisibleRows * blockSizePixels > renderer.GetLogicalHeight())
+	{
+		blockSizePixels = renderer.GetLogicalHeight() / numVisibleRows;
+	}
+	if (snapshot.fieldWidth * blockSizePixels > renderer.GetLogicalWidth() / 2)
+	{
+		blockSizePixels = renderer.GetLogicalWidth() / 2 / snapshot.fieldWidth;
+	}
+	if (blockSizePixels < 1)
+	{
+		blockSizePixels = 1;
+	}
+
+	unsigned int fieldWidthPixels = snapshot.fieldWidth * blockSizePixels;
+	unsigned int fieldHeightPixels = numVisibleRows * blockSizePixels;
+
+	int fieldOffsetPixelsX = 0;
 	if (renderer.GetLogicalWidth() > fieldWidthPixels)
 	{
 		fieldOffsetPixelsX = (renderer.GetLogicalWidth() - fieldWidthPixels) / 2;
 	}
 
-	unsigned int fieldOffsetPixelsY = 0;
+	// не помещающееся даже по пикселю на клетку поле прижимаем к низу экрана: там лежат блоки
+	int fieldOffsetPixelsY = (int)renderer.GetLogicalHeight() - (int)fieldHeightPixels;
 	if (renderer.GetLogicalHeight() > fieldHeightPixels)
 	{
 		fieldOffsetPixelsY = (renderer.GetLogicalHeight() - fieldHeightPixels) / 2;
 	}
 
-	for (unsigned int iy = 0; iy < m_field.height; ++iy)
+	// текстура поля пересоздаётся при первом кадре, после потери содержимого текстур и при смене размера поля.
+	// Неудачное создание не повторяем каждый кадр, а ждём следующего поколения или другого размера
+	if ((!m_pFieldTexture && !m_bFieldTextureFailed) || m_fieldTextureGeneration != renderer.GetRenderTargetGeneration()
+		|| m_fieldTextureWidth != fieldWidthPixels || m_fieldTextureHeight != fieldHeightPixels)
 	{
-		const unsigned int y = fieldOffsetPixelsY + iy * blockSizePixels;
+		if (m_pFieldTexture)
+		{
+			renderer.DestroyRenderTarget(m_pFieldTexture);
+		}
+		m_pFieldTexture = renderer.CreateRenderTarget(fieldWidthPixels, fieldHeightPixels);
+		m_fieldTextureWidth = fieldWidthPixels;
+		m_fieldTextureHeight = fieldHeightPixels;
+		m_fieldTextureGeneration = renderer.GetRenderTargetGeneration();
+		m_bFieldTextureValid = false;
+		m_bFieldTextureFailed = m_pFieldTexture == nullptr;
+	}
 
-		for (unsigned int ix = 0; ix < m_field.width; ++ix)
+	if (m_pFieldTexture)
+	{
+		// высота поля могла смениться при том же размере текстуры в пикселях (другой размер клетки)
+		if (m_fieldTextureRowRevisions.size() != snapshot.fieldHeight)
 		{
-			const unsigned int x = fieldOffsetPixelsX + ix * blockSizePixels;
+			m_bFieldTextureValid = false;
+		}
+		if (!m_bFieldTextureValid)
+		{
+			m_fieldTextureRowRevisions.assign(snapshot.fieldHeight, 0);
+		}
 
-			const int blockState = m_field.staticBlocks[iy * m_field.width + ix];
-			unsigned int blockRgba = 0x202020ff;
-			if (blockState != -1)
+		bool bTargetSet = false;
+		for (unsigned int iy = numHiddenRows; iy < snapshot.fieldHeight; ++iy)
+		{
+			const unsigned int rowRevision = snapshot.rowRevisions[iy];
+			if (m_bFieldTextureValid && m_fieldTextureRowRevisions[iy] == rowRevision)
+				continue;
+
+			if (!bTargetSet)
 			{
-				HP_ASSERT(blockState < kNumTetrominoTypes);
-				blockRgba = s_tetrominos[blockState].rgba;
+				renderer.SetRenderTarget(m_pFieldTexture);
+				bTargetSet = true;
 			}
+			DrawFieldRow(renderer, snapshot, iy, 0, 0, blockSizePixels);
+			m_fieldTextureRowRevisions[iy] = rowRevision;
+		}
+		if (bTargetSet)
+		{
+			renderer.SetRenderTarget(nullptr);
+		}
+		m_bFieldTextureValid = true;
 
-			renderer.DrawSolidRect(x, y, blockSizePixels, blockSizePixels, blockRgba);
-			renderer.DrawRect(x, y, blockSizePixels, blockSizePixels, 0x404040ff);
+		renderer.DrawTexture(m_pFieldTexture, fieldOffsetPixelsX, fieldOffsetPixelsY);
+	}
+	else
+	{
+		// текстуры-цели не поддерживаются или не создались - рисуем поле целиком каждый кадр
+		for (unsigned int iy = numHiddenRows; iy < snapshot.fieldHeight; ++iy)
+		{
+			DrawFieldRow(renderer, snapshot, iy, fieldOffsetPixelsX, fieldOffsetPixelsY, blockSizePixels);
 		}
+		renderer.Flush();	// активная фигура рисуется поверх сетки поля
 	}
 
+	const Tetromino& tetromino = Simulation::GetTetromino(activeTetromino.m_tetrominoType);
+	const Tetromino::BlockCoords& blockCoords = tetromino.blockCoord[activeTetromino.m_rotation];
+
+	// тень - контур фигуры там, куда она упадёт
+	const int dropDistance = snapshot.ghostDropDistance;
+	if (dropDistance > 0 && blockSizePixels > 2)
+	{
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			const int row = activeTetromino.m_pos.y + dropDistance + (int)blockCoords[i].y - (int)numHiddenRows;
+			if (row < 0)
+				continue;
 
-	//   
+			const int x = fieldOffsetPixelsX + (activeTetromino.m_pos.x + (int)blockCoords[i].x) * (int)blockSizePixels;
+			const int y = fieldOffsetPixelsY + row * (int)blockSizePixels;
+			renderer.DrawRect(x + 1, y + 1, blockSizePixels - 2, blockSizePixels - 2, tetromino.rgba);
+		}
+	}
+
+	// нарисуйте активный тетромино
 	for (unsigned int i = 0; i < 4; ++i)
 	{
-		const Tetromino& tetromino = s_tetrominos[m_activeTetromino.m_tetrominoType];
-		const Tetromino::BlockCoords& blockCoords = tetromino.blockCoord[m_activeTetromino.m_rotation];
+		const int row = activeTetromino.m_pos.y + (int)blockCoords[i].y - (int)numHiddenRows;
+		if (row < 0)
+			continue;	// блок ещё в скрытых строках
+
 		unsigned int tetrominoRgba = tetromino.rgba;
-		const unsigned int x = fieldOffsetPixelsX + (m_activeTetromino.m_pos.x + blockCoords[i].x) * blockSizePixels;
-		const unsigned int y = fieldOffsetPixelsY + (m_activeTetromino.m_pos.y + blockCoords[i].y) * blockSizePixels;
+		const int x = fieldOffsetPixelsX + (activeTetromino.m_pos.x + (int)blockCoords[i].x) * (int)blockSizePixels;
+		const int y = fieldOffsetPixelsY + row * (int)blockSizePixels;
 		renderer.DrawSolidRect(x, y, blockSizePixels, blockSizePixels, tetrominoRgba);
 	}
 
+	// очередь следующих фигур справа от поля
+	const unsigned int previewBlockSizePixels = s_kMaxBlockSizePixels / 2;
+	const unsigned int previewX = fieldOffsetPixelsX + fieldWidthPixels + previewBlockSizePixels * 2;
+	const unsigned int previewTopY = fieldOffsetPixelsY > 0 ? fieldOffsetPixelsY : 0;
+	renderer.DrawText("Далее:", previewX, previewTopY, 0xffffffff);
+	for (unsigned int next = 0; next < Simulation::kNumNextTetrominos; ++next)
+	{
+		const Tetromino& nextTetromino = Simulation::GetTetromino(snapshot.nextTetrominos[next]);
+		const unsigned int previewY = previewTopY + previewBlockSizePixels * 2 + next * 3 * previewBlockSizePixels;
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			const unsigned int x = previewX + nextTetromino.blockCoord[0][i].x * previewBlockSizePixels;
+			const unsigned int y = previewY + nextTetromino.blockCoord[0][i].y * previewBlockSizePixels;
+			renderer.DrawSolidRect(x, y, previewBlockSizePixels, previewBlockSizePixels, nextTetromino.rgba);
+		}
+	}
+
 	char text[128];
-	snprintf(text, sizeof(text), ": %u", m_numLinesCleared);
-	renderer.DrawText(text, 0, 100, 0xffffffff);
-	snprintf(text, sizeof(text), ": %u", m_level);
-	renderer.DrawText(text, 0, 140, 0xffffffff);
-	snprintf(text, sizeof(text), ": %u", m_score);
-	renderer.DrawText(text, 0, 180, 0xffffffff);
-	snprintf(text, sizeof(text), " : %u", m_hiScore); //     
-	renderer.DrawText(text, 0, 220, 0xffffffff);
+	snprintf(text, sizeof(text), "Линии: %u", snapshot.numLinesCleared);
+	renderer.DrawDynamicText(text, 0, 100, 0xffffffff);
+	snprintf(text, sizeof(text), "Уровень: %u", snapshot.level);
+	renderer.DrawDynamicText(text, 0, 140, 0xffffffff);
+	snprintf(text, sizeof(text), "Счёт: %u", snapshot.score);
+	renderer.DrawDynamicText(text, 0, 180, 0xffffffff);
+	snprintf(text, sizeof(text), "Лучший счёт: %u", snapshot.hiScore); //добавить в меню пункт с просмотром
+	renderer.DrawDynamicText(text, 0, 220, 0xffffffff);
+	if (snapshot.bAutoplay)
+	{
+		snprintf(text, sizeof(text), "Автоигра: %.0f мкс на ход", snapshot.autoplaySearchSeconds * 1e6);
+		renderer.DrawDynamicText(text, 0, 260, 0x8080ffff);
+	}
 
 #ifdef _DEBUG
-	snprintf(text, sizeof(text), "ESC - ", m_framesPerFallStep);
+	snprintf(text, sizeof(text), "ESC - ВЫХОД", snapshot.ticksPerFallStep);
 	renderer.DrawText(text, 0, 400, 0x404040ff);
-	snprintf(text, sizeof(text), "P - ", m_framesPerFallStep);
+	snprintf(text, sizeof(text), "P - ПАУЗА", snapshot.ticksPerFallStep);
 	renderer.DrawText(text, 0, 500, 0x404040ff);
+	renderer.DrawText("G - ТЕНЬ ФИГУРЫ", 0, 600, 0x404040ff);
 #endif
 }
+
+void Game::DrawFieldRow(Renderer& renderer, const GameSnapshot& snapshot, unsigned int iy, int originX, int originY, unsigned int blockSizePixels)
+{
+	const int y = originY + (int)((iy - snapshot.fieldNumHiddenRows) * blockSizePixels);	// первая видимая строка рисуется в originY
+
+	for (unsigned int ix = 0; ix < snapshot.fieldWidth; ++ix)
+	{
+		const unsigned int x = originX + ix * blockSizePixels;
+
+		const int blockState = snapshot.staticBlocks[iy * snapshot.fieldWidth + ix];
+		unsigned int blockRgba = 0x202020ff;
+		if (blockState != -1)
+		{
+			HP_ASSERT(blockState < kNumTetrominoTypes);
+			blockRgba = Simulation::GetTetromino((TetrominoType)blockState).rgba;
+		}
+
+		renderer.DrawSolidRect(x, y, blockSizePixels, blockSizePixels, blockRgba);
+		if (blockSizePixels > 2)	// у мелких клеток сетка закрыла бы их целиком
+		{
+			renderer.DrawRect(x, y, blockSizePixels, blockSizePixels, 0x404040ff);
+		}
+	}
+}
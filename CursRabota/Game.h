@@ -1,89 +1,27 @@
 //--------------------------------------------------------------------------------------------------
 /**
-	   Game.h
+	файл   Game.h
 **/
 //--------------------------------------------------------------------------------------------------
-#include "Renderer.h"
 #ifndef GAME_H
 #define GAME_H
 
-//  ,      
-class Renderer;
+#include "AutoPlayer.h"
+#include "GameSnapshot.h"
+#include "InputQueue.h"
+#include "Replay.h"
+#include "Simulation.h"
 
-//        
-struct uint2
-{
-	unsigned int x;
-	unsigned int y;
-};
-//        
-struct int2
-{
-	int x;
-	int y;
-};
-//  -   
-struct Field
-{
-	unsigned int width; // 
-	unsigned int height;// 
-	int* staticBlocks;		// -1 = 
-};
+#include <string>
+#include <vector>
 
-struct Tetromino
-{
-	static const unsigned int kNumBlocks = 4;
-	static const unsigned int kNumRotations = 4;
-	typedef uint2 BlockCoords[kNumBlocks];
-
-	BlockCoords blockCoord[kNumRotations];
-	unsigned int rgba;
-};
-
-enum TetrominoType
-{
-	kTetrominoType_I = 0,
-	kTetrominoType_J,
-	kTetrominoType_L,
-	kTetrominoType_O,
-	kTetrominoType_S,
-	kTetrominoType_T,
-	kTetrominoType_Z,
-	kNumTetrominoTypes
-};
-
-struct TetrominoInstance
-{
-	TetrominoType m_tetrominoType;
-	int2 m_pos;
-	unsigned int m_rotation;
-};
-// ,    
-struct GameInput
-{
-	bool bStart;
-	bool bMoveLeft;
-	bool bMoveRight;
-	bool bRotateClockwise;			
-	bool bRotateAnticlockwise;		
-	bool bHardDrop;
-	bool bSoftDrop;
-	bool bPause; //+
-	bool WatchHighScore; //  +
-	bool Rules; //  +
-
-#ifdef _DEBUG
-	bool bDebugChangeTetromino;
-	bool bDebugMoveLeft;
-	bool bDebugMoveRight;
-	bool bDebugMoveUp;
-	bool bDebugMoveDown;
-#endif
-};
+//класс для рендера, наследование класса для рендеринга игровых объектов
+class Renderer;
+struct SDL_Texture;
 
 //--------------------------------------------------------------------------------------------------
 /**
-	\   Game
+	\класс   Game
 **/
 //--------------------------------------------------------------------------------------------------
 
@@ -94,37 +32,62 @@ public:
 	Game();
 	~Game();
 
-	bool			Init(); //
+	// зерно первой партии, следующие партии берут seed + 1, seed + 2...; pAutoplaySettings == nullptr - играет человек
+	bool			Init(unsigned int seed, const char* pRecordPath, const AutoPlayer::Settings* pAutoplaySettings);
+	void			SetAutoShift(unsigned int delayMs, unsigned int repeatMs) { m_simulation.SetAutoShift(delayMs, repeatMs); }
+	unsigned int	GetAutoShiftDelayMs() const { return m_simulation.GetAutoShiftDelayMs(); }
+	unsigned int	GetAutoRepeatMs() const { return m_simulation.GetAutoRepeatMs(); }
+	void			SetFieldSize(const FieldSize& fieldSize) { m_simulation.SetFieldSize(fieldSize); }
 	void			Shutdown();//
 	void			Reset();//
 	void			Update(const GameInput& gameInput, float deltaTimeSeconds);//
+	// ввод из потока событий: каждая запись попадает в тот такт, за время которого она пришла, а не в первый такт кадра.
+	// Записи упорядочены по времени; gameInput - все записи кадра вместе, из него берутся только меню и пауза
+	void			UpdateTimed(const GameInput& gameInput, const InputRecord* pRecords, unsigned int numRecords,
+						long long frameTimeMicroseconds, float deltaTimeSeconds);
 	void			Draw(Renderer& renderer);//
+	// для потока отрисовки: снимок пишет поток игры, рисуется он без обращения к симуляции.
+	// Draw со снимком меняет только текстуру поля, поэтому может идти параллельно с Update
+	void			WriteSnapshot(GameSnapshot& snapshot) const;
+	void			Draw(Renderer& renderer, const GameSnapshot& snapshot, float frameSeconds);
+	bool			IsStatic() const { return m_gameState != kGameState_Playing; }	// картинка меняется только от ввода
 
 private:
 
 	void			InitPlaying();//
-	void			UpdatePlaying(const GameInput& gameInput);//
-	void			DrawPlaying(Renderer& renderer);//
+	void			DrawPlaying(Renderer& renderer, const GameSnapshot& snapshot);//
+	void			TakeTimedInputs(long long untilMicroseconds);
+	void			DrawFieldRow(Renderer& renderer, const GameSnapshot& snapshot, unsigned int iy, int originX, int originY, unsigned int blockSizePixels);
 
-	bool			SpawnTetronimo();//
-	void			AddTetronimoToField(const Field& field, const TetrominoInstance& tetronimoInstance); //
-
-	// 
+	// положение
 	float m_deltaTimeSeconds;
-	Field m_field;
-	TetrominoInstance m_activeTetromino;
+	Simulation m_simulation;	// правила игры
 
-	int m_framesUntilFall;
-	int m_framesPerFallStep;	//  ,       
+	// время кадра копится и расходуется тактами симуляции фиксированной длины, поэтому скорость
+	// игры не зависит от частоты кадров; ввод, пришедший между тактами, применяется в ближайшем такте
+	float m_tickAccumulatorSeconds;
+	uint16_t m_pendingInputBits;
+	bool m_bHoldLeft;
+	bool m_bHoldRight;
 
-	unsigned int m_numUserDropsForThisTetronimo;
+	// записи ввода текущего UpdateTimed, nullptr - ввод одним GameInput на кадр
+	const InputRecord* m_pTimedInputs;
+	unsigned int m_numTimedInputs;
+	unsigned int m_numTimedInputsTaken;
+	long long m_frameTimeMicroseconds;
 
-	// 
-	unsigned int m_numLinesCleared;
-	unsigned int m_level;
-	unsigned int m_score;
 	unsigned int m_hiScore;
-	//  -   
+	unsigned int m_seed;
+	unsigned int m_numGamesStarted;
+
+	// запись партии: ввод каждого кадра симуляции, файл пишется по окончании партии
+	ReplayRecorder m_replayRecorder;
+	std::string m_recordPath;
+
+	// автоигра: фигурами управляет перебор мест, с клавиатуры остаются пауза и меню
+	AutoPlayer m_autoPlayer;
+	bool m_bAutoplay;
+	// объединение - состояине игры 
 	enum GameState
 	{
 		kGameState_TitleScreen = 0,
@@ -136,6 +99,19 @@ private:
 	};
 
 	GameState m_gameState;
+
+	bool m_bShowGhost;	// рисовать, куда упадёт фигура
+
+	// закреплённые блоки рисуются в текстуру, перерисовываются только изменившиеся строки
+	SDL_Texture* m_pFieldTexture;
+	unsigned int m_fieldTextureWidth;	// в пикселях: при смене размера поля текстура пересоздаётся
+	unsigned int m_fieldTextureHeight;
+	unsigned int m_fieldTextureGeneration;
+	std::vector<unsigned int> m_fieldTextureRowRevisions;	// ревизии строк, нарисованных в текстуре
+	bool m_bFieldTextureValid;
+	bool m_bFieldTextureFailed;	// создать не удалось: до смены поколения или размера рисуем поле без текстуры
+
+	GameSnapshot m_drawSnapshot;	// Draw без потока отрисовки рисует через него же
 };
 
 #endif // GAME_H
@@ -0,0 +1,78 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    GameSnapshot.cpp
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "GameSnapshot.h"
+
+#include <chrono>
+
+static const unsigned int s_kNewBit = 0x80000000u;
+
+//--------------------------------------------------------------------------------------------------
+
+GameSnapshot::GameSnapshot()
+	: gameState(0)
+	, hiScore(0)
+	, numLinesCleared(0)
+	, level(0)
+	, score(0)
+	, ticksPerFallStep(0)
+	, fieldWidth(0)
+	, fieldHeight(0)
+	, fieldNumHiddenRows(0)
+	, ghostDropDistance(0)
+	, bAutoplay(false)
+	, autoplaySearchSeconds(0.0f)
+	, numInputTimestamps(0)
+{
+	activeTetromino.m_tetrominoType = kTetrominoType_I;
+	activeTetromino.m_pos.x = 0;
+	activeTetromino.m_pos.y = 0;
+	activeTetromino.m_rotation = 0;
+	for (unsigned int i = 0; i < Simulation::kNumNextTetrominos; ++i)
+	{
+		nextTetrominos[i] = kTetrominoType_I;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------
+
+GameSnapshotBuffer::GameSnapshotBuffer()
+	: m_writeIndex(0)
+	, m_readIndex(1)
+	, m_readyIndex(2)
+{
+}
+
+bool GameSnapshotBuffer::Publish()
+{
+	// release - снимок дописан до того, как читатель увидит его номер; acquire - забираем снимок,
+	// который читатель уже отпустил
+	const unsigned int previous = m_readyIndex.exchange(m_writeIndex | s_kNewBit, std::memory_order_acq_rel);
+	m_writeIndex = previous & ~s_kNewBit;
+	{
+		// читатель либо ещё не проверил s_kNewBit и увидит снимок, либо уже ждёт и получит notify
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+	}
+	m_published.notify_one();
+	return (previous & s_kNewBit) != 0;
+}
+
+bool GameSnapshotBuffer::Acquire()
+{
+	if ((m_readyIndex.load(std::memory_order_relaxed) & s_kNewBit) == 0)
+		return false;
+
+	const unsigned int previous = m_readyIndex.exchange(m_readIndex, std::memory_order_acq_rel);
+	m_readIndex = previous & ~s_kNewBit;
+	return true;
+}
+
+bool GameSnapshotBuffer::WaitForPublish(unsigned int timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(m_wakeMutex);
+	return m_published.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+		[this]() { return (m_readyIndex.load(std::memory_order_relaxed) & s_kNewBit) != 0; });
+}
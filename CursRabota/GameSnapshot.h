@@ -0,0 +1,90 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    GameSnapshot.h
+**/
+//--------------------------------------------------------------------------------------------------
+
+#ifndef GAME_SNAPSHOT_H
+#define GAME_SNAPSHOT_H
+
+#include "Simulation.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// Всё, что нужно Game::Draw, на момент одного кадра симуляции. Пишет поток игры, читает поток отрисовки,
+// поэтому снимок не ссылается на память игры. Клетки поля копируются только в изменившихся строках
+struct GameSnapshot
+{
+	static const unsigned int kMaxInputTimestamps = 64;
+
+	unsigned int	gameState;			// Game::GameState
+	unsigned int	hiScore;
+	unsigned int	numLinesCleared;
+	unsigned int	level;
+	unsigned int	score;
+	int				ticksPerFallStep;
+
+	unsigned int		fieldWidth;
+	unsigned int		fieldHeight;
+	unsigned int		fieldNumHiddenRows;
+	std::vector<int>	staticBlocks;		// как Field::staticBlocks
+	std::vector<unsigned int>	rowRevisions;	// Simulation::GetRowRevision, по ним копируются и перерисовываются строки
+
+	TetrominoInstance	activeTetromino;
+	TetrominoType		nextTetrominos[Simulation::kNumNextTetrominos];
+	int					ghostDropDistance;	// 0 - тень не рисуется
+
+	bool			bAutoplay;
+	float			autoplaySearchSeconds;
+
+	// нажатия, которые попали в снимок: после его Present считается задержка
+	unsigned int	inputTimestampsMs[kMaxInputTimestamps];
+	unsigned int	numInputTimestamps;
+
+	GameSnapshot();
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+	\class   GameSnapshotBuffer
+**/
+//--------------------------------------------------------------------------------------------------
+
+// Тройной буфер снимков без блокировок: у писателя и читателя по своему снимку, третий - последний готовый.
+// Публикация и захват только меняют номера снимков, поэтому ни поток игры, ни поток отрисовки не ждут друг друга.
+// Если читатель не успел забрать снимок, следующая публикация его заменяет.
+// Мьютекс нужен только чтобы будить читателя, который спит в WaitForPublish
+class GameSnapshotBuffer
+{
+public:
+
+	GameSnapshotBuffer();
+
+	// писатель
+	GameSnapshot&	GetWriteSnapshot() { return m_snapshots[m_writeIndex]; }
+	bool			Publish();	// true - предыдущий снимок так и не был прочитан и теперь снова у писателя
+
+	// читатель
+	bool			Acquire();	// false - нового снимка нет, GetReadSnapshot() прежний
+	bool			WaitForPublish(unsigned int timeoutMs);	// false - за timeoutMs нового снимка не было
+	const GameSnapshot&	GetReadSnapshot() const { return m_snapshots[m_readIndex]; }
+
+private:
+
+	GameSnapshotBuffer(const GameSnapshotBuffer&);
+	GameSnapshotBuffer& operator=(const GameSnapshotBuffer&);
+
+	static const unsigned int kNumSnapshots = 3;
+
+	GameSnapshot				m_snapshots[kNumSnapshots];
+	unsigned int				m_writeIndex;		// только писатель
+	unsigned int				m_readIndex;		// только читатель
+	std::atomic<unsigned int>	m_readyIndex;		// номер готового снимка | s_kNewBit, если его ещё не читали
+	std::mutex					m_wakeMutex;
+	std::condition_variable		m_published;
+};
+
+#endif // GAME_SNAPSHOT_H
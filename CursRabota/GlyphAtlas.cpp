@@ -0,0 +1,211 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    GlyphAtlas.cpp
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "GlyphAtlas.h"
+
+#include "Debug.h"
+
+#include "SDL.h"
+
+#include <stdio.h>
+
+static const int s_kAtlasWidth = 512;
+static const int s_kGlyphPadding = 1;	// чтобы при масштабировании не захватывать соседние глифы
+
+// cp1251 0x80..0xBF -> юникод (0xC0..0xFF это подряд А..я)
+static const Uint16 s_cp1251Upper[64] =
+{
+	0x0402, 0x0403, 0x201A, 0x0453, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x20AC, 0x2030, 0x0409, 0x2039, 0x040A, 0x040C, 0x040B, 0x040F,
+	0x0452, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x003F, 0x2122, 0x0459, 0x203A, 0x045A, 0x045C, 0x045B, 0x045F,
+	0x00A0, 0x040E, 0x045E, 0x0408, 0x00A4, 0x0490, 0x00A6, 0x00A7,
+	0x0401, 0x00A9, 0x0404, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x0407,
+	0x00B0, 0x00B1, 0x0406, 0x0456, 0x0491, 0x00B5, 0x00B6, 0x00B7,
+	0x0451, 0x2116, 0x0454, 0x00BB, 0x0458, 0x0405, 0x0455, 0x0457,
+};
+
+//--------------------------------------------------------------------------------------------------
+
+Uint16 GlyphAtlas::CodepointFromCp1251(unsigned char c)
+{
+	if (c < 0x80)
+		return c;
+	if (c < 0xC0)
+		return s_cp1251Upper[c - 0x80];
+	return (Uint16)(0x0410 + (c - 0xC0));
+}
+
+GlyphAtlas::GlyphAtlas(SDL_Renderer& sdlRenderer, TTF_Font& font)
+	: m_sdlRenderer(sdlRenderer)
+	, m_pTexture(nullptr)
+	, m_textureWidth(s_kAtlasWidth)
+	, m_textureHeight(0)
+	, m_lastNumDrawCalls(0)
+{
+	const SDL_Color white = { 0xff, 0xff, 0xff, 0xff };
+	SDL_Surface* glyphSurfaces[kNumGlyphs] = {};
+
+	// растеризуем глифы и раскладываем их по строкам атласа
+	const int lineHeight = TTF_FontHeight(&font);
+	int penX = 0;
+	int penY = 0;
+	for (unsigned int i = 0; i < kNumGlyphs; ++i)
+	{
+		Glyph& glyph = m_glyphs[i];
+		glyph = Glyph();
+
+		const Uint16 codepoint = CodepointFromCp1251((unsigned char)(kFirstGlyph + i));
+		int minX, maxX, minY, maxY;
+		if (!TTF_GlyphIsProvided(&font, codepoint) || TTF_GlyphMetrics(&font, codepoint, &minX, &maxX, &minY, &maxY, &glyph.advance) != 0)
+			continue;
+
+		glyphSurfaces[i] = TTF_RenderGlyph_Blended(&font, codepoint, white);
+		if (!glyphSurfaces[i])
+			continue;
+
+		glyph.width = glyphSurfaces[i]->w;
+		glyph.height = glyphSurfaces[i]->h;
+		if (penX + glyph.width > s_kAtlasWidth)
+		{
+			penX = 0;
+			penY += lineHeight + s_kGlyphPadding;
+		}
+		glyph.srcX = penX;
+		glyph.srcY = penY;
+		penX += glyph.width + s_kGlyphPadding;
+	}
+	m_textureHeight = penY + lineHeight;
+
+	SDL_Surface* pAtlasSurface = SDL_CreateRGBSurfaceWithFormat(0, m_textureWidth, m_textureHeight, 32, SDL_PIXELFORMAT_RGBA32);
+	if (!pAtlasSurface)
+	{
+		fprintf(stderr, "SDL_CreateRGBSurfaceWithFormat failed: %s\n", SDL_GetError());
+	}
+
+	for (unsigned int i = 0; i < kNumGlyphs; ++i)
+	{
+		if (!glyphSurfaces[i])
+			continue;
+
+		if (pAtlasSurface)
+		{
+			SDL_Rect dstRect = { m_glyphs[i].srcX, m_glyphs[i].srcY, m_glyphs[i].width, m_glyphs[i].height };
+			SDL_SetSurfaceBlendMode(glyphSurfaces[i], SDL_BLENDMODE_NONE);	// копируем альфу как есть
+			SDL_BlitSurface(glyphSurfaces[i], nullptr, pAtlasSurface, &dstRect);
+		}
+		SDL_FreeSurface(glyphSurfaces[i]);
+	}
+
+	if (pAtlasSurface)
+	{
+		m_pTexture = SDL_CreateTextureFromSurface(&m_sdlRenderer, pAtlasSurface);
+		SDL_FreeSurface(pAtlasSurface);
+	}
+
+	if (!m_pTexture)
+	{
+		fprintf(stderr, "Failed to create glyph atlas texture: %s\n", SDL_GetError());
+		return;
+	}
+
+	SDL_SetTextureBlendMode(m_pTexture, SDL_BLENDMODE_BLEND);
+	printf("Glyph atlas = (%d, %d)\n", m_textureWidth, m_textureHeight);
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+	SDL_DestroyTexture(m_pTexture);
+}
+
+void GlyphAtlas::DrawText(const char* text, int x, int y, uint32_t rgba)
+{
+	SDL_assert(text);
+	HP_ASSERT(m_pTexture);
+
+	const Uint8 r = (Uint8)((rgba >> 24) & 0xff);
+	const Uint8 g = (Uint8)((rgba >> 16) & 0xff);
+	const Uint8 b = (Uint8)((rgba >> 8) & 0xff);
+	const Uint8 a = (Uint8)((rgba >> 0) & 0xff);
+
+	m_lastNumDrawCalls = 0;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	// вся строка одним вызовом
+	m_vertices.clear();
+	m_indices.clear();
+	const float invWidth = 1.0f / (float)m_textureWidth;
+	const float invHeight = 1.0f / (float)m_textureHeight;
+	int penX = x;
+	for (const unsigned char* p = (const unsigned char*)text; *p; ++p)
+	{
+		if (*p < kFirstGlyph)
+			continue;
+
+		const Glyph& glyph = m_glyphs[*p - kFirstGlyph];
+		if (glyph.width > 0)
+		{
+			const int baseIndex = (int)m_vertices.size();
+			const float x0 = (float)penX;
+			const float y0 = (float)y;
+			const float x1 = (float)(penX + glyph.width);
+			const float y1 = (float)(y + glyph.height);
+			const float u0 = glyph.srcX * invWidth;
+			const float v0 = glyph.srcY * invHeight;
+			const float u1 = (glyph.srcX + glyph.width) * invWidth;
+			const float v1 = (glyph.srcY + glyph.height) * invHeight;
+
+			SDL_Vertex vertex;
+			vertex.color.r = r;
+			vertex.color.g = g;
+			vertex.color.b = b;
+			vertex.color.a = a;
+			vertex.position.x = x0; vertex.position.y = y0; vertex.tex_coord.x = u0; vertex.tex_coord.y = v0;
+			m_vertices.push_back(vertex);
+			vertex.position.x = x1; vertex.position.y = y0; vertex.tex_coord.x = u1; vertex.tex_coord.y = v0;
+			m_vertices.push_back(vertex);
+			vertex.position.x = x1; vertex.position.y = y1; vertex.tex_coord.x = u1; vertex.tex_coord.y = v1;
+			m_vertices.push_back(vertex);
+			vertex.position.x = x0; vertex.position.y = y1; vertex.tex_coord.x = u0; vertex.tex_coord.y = v1;
+			m_vertices.push_back(vertex);
+
+			const int quadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+			for (unsigned int i = 0; i < 6; ++i)
+			{
+				m_indices.push_back(baseIndex + quadIndices[i]);
+			}
+		}
+		penX += glyph.advance;
+	}
+
+	if (!m_vertices.empty())
+	{
+		SDL_RenderGeometry(&m_sdlRenderer, m_pTexture, m_vertices.data(), (int)m_vertices.size(), m_indices.data(), (int)m_indices.size());
+		m_lastNumDrawCalls = 1;
+	}
+#else
+	// SDL < 2.0.18: по одному копированию на глиф, SDL сам соберёт их в пакет
+	SDL_SetTextureColorMod(m_pTexture, r, g, b);
+	SDL_SetTextureAlphaMod(m_pTexture, a);
+
+	int penX = x;
+	for (const unsigned char* p = (const unsigned char*)text; *p; ++p)
+	{
+		if (*p < kFirstGlyph)
+			continue;
+
+		const Glyph& glyph = m_glyphs[*p - kFirstGlyph];
+		if (glyph.width > 0)
+		{
+			SDL_Rect srcRect = { glyph.srcX, glyph.srcY, glyph.width, glyph.height };
+			SDL_Rect dstRect = { penX, y, glyph.width, glyph.height };
+			SDL_RenderCopy(&m_sdlRenderer, m_pTexture, &srcRect, &dstRect);
+			++m_lastNumDrawCalls;
+		}
+		penX += glyph.advance;
+	}
+#endif
+}
@@ -0,0 +1,63 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    GlyphAtlas.h
+**/
+//--------------------------------------------------------------------------------------------------
+
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include "SDL_ttf.h"
+
+#include <stdint.h>
+#include <vector>
+
+// SDL forward
+struct SDL_Renderer;
+struct SDL_Texture;
+
+// Атлас глифов: все символы кодировки cp1251 растеризуются один раз в одну текстуру,
+// строка рисуется набором четырёхугольников из атласа без выделения памяти под текстуры
+class GlyphAtlas
+{
+public:
+
+	GlyphAtlas(SDL_Renderer& sdlRenderer, TTF_Font& font);
+	~GlyphAtlas();
+
+	bool			IsValid() const { return m_pTexture != nullptr; }
+	void			DrawText(const char* text, int x, int y, uint32_t rgba);
+
+	unsigned int	GetLastNumDrawCalls() const { return m_lastNumDrawCalls; }	// вызовов SDL в последнем DrawText
+
+	// строки в игре хранятся в cp1251, шрифт ждёт юникод
+	static Uint16	CodepointFromCp1251(unsigned char c);
+
+private:
+
+	static const unsigned int kFirstGlyph = 0x20;
+	static const unsigned int kNumGlyphs = 256 - kFirstGlyph;
+
+	struct Glyph
+	{
+		int		srcX;
+		int		srcY;
+		int		width;
+		int		height;
+		int		advance;
+	};
+
+	SDL_Renderer&	m_sdlRenderer;
+	SDL_Texture*	m_pTexture;
+	int				m_textureWidth;
+	int				m_textureHeight;
+	Glyph			m_glyphs[kNumGlyphs];
+	unsigned int	m_lastNumDrawCalls;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	std::vector<SDL_Vertex>	m_vertices;		// переиспользуются между кадрами
+	std::vector<int>		m_indices;
+#endif
+};
+
+#endif // GLYPH_ATLAS_H
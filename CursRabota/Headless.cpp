@@ -0,0 +1,338 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    Headless.cpp
+
+	Прогон партий без окна и без SDL: кадры симуляции идут так быстро, как позволяет процессор
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "AutoPlayer.h"
+#include "Replay.h"
+#include "Simulation.h"
+#include "ThreadPool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+
+// случайный ввод, не зависящий от генератора фигур симуляции
+static unsigned int NextRandom(unsigned int& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static void MakeRandomInput(unsigned int& state, GameInput& gameInput)
+{
+	gameInput = GameInput();
+
+	const unsigned int r = NextRandom(state) % 100;
+	if (r < 10)
+		gameInput.bMoveLeft = true;
+	else if (r < 20)
+		gameInput.bMoveRight = true;
+	else if (r < 25)
+		gameInput.bRotateClockwise = true;
+	else if (r < 30)
+		gameInput.bSoftDrop = true;
+	else if (r < 32)
+		gameInput.bHardDrop = true;
+}
+
+// итог одной партии; партии пишут в свои элементы массива, поэтому сумма не зависит от числа потоков
+struct GameResult
+{
+	unsigned int	frames;
+	unsigned int	placed;
+	unsigned int	lines;
+	unsigned int	score;
+	uint64_t		fieldHash;
+};
+
+// состояние потока: своя симуляция и свой автоигрок, общих данных между потоками нет
+struct WorkerState
+{
+	Simulation	simulation;
+	AutoPlayer	autoPlayer;
+};
+
+// pAutoPlayer == nullptr - случайный ввод
+static void RunGame(Simulation& simulation, AutoPlayer* pAutoPlayer, unsigned int gameSeed, unsigned int maxFramesPerGame,
+	ReplayRecorder* pRecorder, GameResult& result)
+{
+	unsigned int inputState = gameSeed * 2654435761u + 1;	// xorshift не должен стартовать с нуля
+	if (inputState == 0)
+		inputState = 1;
+
+	simulation.NewGame(gameSeed);
+	if (pAutoPlayer)
+	{
+		pAutoPlayer->Reset();
+	}
+	if (pRecorder)
+	{
+		pRecorder->Begin(gameSeed, simulation.GetAutoShiftDelayMs(), simulation.GetAutoRepeatMs(), simulation.GetFieldSize());
+	}
+
+	unsigned int frame = 0;
+	while (!simulation.IsGameOver() && frame < maxFramesPerGame)
+	{
+		GameInput gameInput;
+		if (pAutoPlayer)
+			pAutoPlayer->MakeInput(simulation, gameInput);
+		else
+			MakeRandomInput(inputState, gameInput);
+		simulation.Update(gameInput);
+		if (pRecorder)
+		{
+			pRecorder->AddFrame(gameInput);
+		}
+		++frame;
+	}
+
+	result.frames = frame;
+	result.placed = simulation.GetNumTetrominosPlaced();
+	result.lines = simulation.GetNumLinesCleared();
+	result.score = simulation.GetScore();
+	result.fieldHash = HashField(simulation.GetField());
+}
+
+// воспроизведение записанной партии: вывод сравнивается между версиями кода
+static int PlayReplay(const char* path)
+{
+	ReplayPlayer player;
+	if (!player.Load(path))
+		return 1;
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	Simulation simulation;
+	simulation.SetAutoShift(player.GetAutoShiftDelayMs(), player.GetAutoRepeatMs());
+	simulation.SetFieldSize(player.GetFieldSize());
+	simulation.NewGame(player.GetSeed());
+	unsigned int frame = 0;
+	GameInput gameInput;
+	while (player.NextFrame(gameInput))
+	{
+		simulation.Update(gameInput);
+		++frame;
+	}
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	const double seconds = std::chrono::duration<double>(endTime - startTime).count();
+
+	printf("replay=%s seed=%u frames=%u placed=%u lines=%u score=%u game_over=%d field_hash=%016llx\n", path, player.GetSeed(),
+		frame, simulation.GetNumTetrominosPlaced(), simulation.GetNumLinesCleared(), simulation.GetScore(),
+		simulation.IsGameOver() ? 1 : 0, (unsigned long long)HashField(simulation.GetField()));
+	printf("time=%.6fs frames/s=%.0f\n", seconds, seconds > 0.0 ? frame / seconds : 0.0);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int numGames = 1000;
+	unsigned int seed = 1;
+	unsigned int maxFramesPerGame = 1000000;
+	unsigned int numThreads = 0;	// 0 - по числу ядер
+	bool bVerbose = false;
+	bool bAutoplay = false;
+	AutoPlayer::Settings autoPlayerSettings = AutoPlayer::GetDefaultSettings();	// в партиях уже по потоку на ядро
+	FieldSize fieldSize = Simulation::GetDefaultFieldSize();
+	const char* pRecordPath = nullptr;
+	const char* pReplayPath = nullptr;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+		{
+			numGames = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--max-frames") == 0 && i + 1 < argc)
+		{
+			maxFramesPerGame = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+		{
+			numThreads = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--autoplay") == 0)
+		{
+			bAutoplay = true;
+		}
+		else if (strcmp(argv[i], "--ai-depth") == 0 && i + 1 < argc)
+		{
+			autoPlayerSettings.searchDepth = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--ai-beam") == 0 && i + 1 < argc)
+		{
+			autoPlayerSettings.beamWidth = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--ai-threads") == 0 && i + 1 < argc)
+		{
+			autoPlayerSettings.numThreads = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--ai-tt-mb") == 0 && i + 1 < argc)
+		{
+			autoPlayerSettings.transpositionTableBytes = (size_t)atoi(argv[++i]) << 20;
+		}
+		else if (strcmp(argv[i], "--field-width") == 0 && i + 1 < argc)
+		{
+			fieldSize.width = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--field-height") == 0 && i + 1 < argc)
+		{
+			fieldSize.height = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--hidden-rows") == 0 && i + 1 < argc)
+		{
+			fieldSize.numHiddenRows = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--verbose") == 0)
+		{
+			bVerbose = true;
+		}
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+		{
+			pRecordPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			pReplayPath = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--games N] [--seed S] [--max-frames F] [--threads T] [--autoplay] [--ai-depth D] [--ai-beam B] [--ai-threads T] [--ai-tt-mb M] [--field-width W] [--field-height H] [--hidden-rows R] [--verbose] [--record file] [--replay file]\n", argv[0]);
+			fprintf(stderr, "  --threads T     worker threads, 0 = one per core (default)\n");
+			fprintf(stderr, "  --autoplay      play with the placement search instead of random input\n");
+			fprintf(stderr, "  --ai-depth D    pieces searched by the autoplayer: current + D-1 from the queue (1..%u, default 1)\n", AutoPlayer::kMaxSearchDepth);
+			fprintf(stderr, "  --ai-beam B     fields kept after each searched piece (default 1)\n");
+			fprintf(stderr, "  --ai-threads T  search threads per autoplayer, 0 = one per core (default 1)\n");
+			fprintf(stderr, "  --ai-tt-mb M    transposition table per autoplayer in MiB, 0 = off (default 0)\n");
+			fprintf(stderr, "  --field-width W    field columns (%u..%u, default %u)\n", Simulation::kMinFieldWidth, Simulation::kMaxFieldWidth,
+				Simulation::GetDefaultFieldSize().width);
+			fprintf(stderr, "  --field-height H   visible field rows (%u..%u, default %u)\n", Simulation::kMinFieldHeight, Simulation::kMaxFieldHeight,
+				Simulation::GetDefaultFieldSize().height);
+			fprintf(stderr, "  --hidden-rows R    spawn rows above the visible field (0..%u, default %u)\n", Simulation::kMaxNumHiddenRows,
+				Simulation::GetDefaultFieldSize().numHiddenRows);
+			fprintf(stderr, "  --record file   write the first game to a replay file\n");
+			fprintf(stderr, "  --replay file   play a replay file back and print the result\n");
+			return 1;
+		}
+	}
+
+	if (pReplayPath)
+	{
+		return PlayReplay(pReplayPath);
+	}
+
+	if (!Simulation::IsValidFieldSize(fieldSize))
+	{
+		fprintf(stderr, "Invalid field size %ux%u+%u\n", fieldSize.width, fieldSize.height, fieldSize.numHiddenRows);
+		return 1;
+	}
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	// у каждого потока своя симуляция, партии раздаются кусками и перераспределяются кражей работы
+	ThreadPool threadPool(numThreads);
+	std::vector<std::unique_ptr<WorkerState>> workers(threadPool.GetNumThreads());
+	for (std::unique_ptr<WorkerState>& pWorker : workers)
+	{
+		pWorker.reset(new WorkerState());
+		pWorker->simulation.SetFieldSize(fieldSize);
+		pWorker->autoPlayer.Configure(autoPlayerSettings);
+	}
+
+	std::vector<GameResult> results(numGames);
+	ReplayRecorder recorder;
+	threadPool.ParallelFor(0, numGames, 16, [&](unsigned int workerIndex, uint64_t begin, uint64_t end)
+	{
+		WorkerState& worker = *workers[workerIndex];
+		AutoPlayer* pAutoPlayer = bAutoplay ? &worker.autoPlayer : nullptr;
+		for (uint64_t game = begin; game < end; ++game)
+		{
+			ReplayRecorder* pRecorder = (pRecordPath && game == 0) ? &recorder : nullptr;
+			RunGame(worker.simulation, pAutoPlayer, seed + (unsigned int)game, maxFramesPerGame, pRecorder, results[game]);
+		}
+	});
+	if (recorder.IsRecording())
+	{
+		recorder.Save(pRecordPath);
+	}
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	const double seconds = std::chrono::duration<double>(endTime - startTime).count();
+
+	unsigned long long totalFrames = 0;
+	unsigned long long totalPlaced = 0;
+	unsigned long long totalLines = 0;
+	unsigned long long totalScore = 0;
+	unsigned int maxScore = 0;
+	for (unsigned int game = 0; game < numGames; ++game)
+	{
+		const GameResult& result = results[game];
+		totalFrames += result.frames;
+		totalPlaced += result.placed;
+		totalLines += result.lines;
+		totalScore += result.score;
+		if (result.score > maxScore)
+			maxScore = result.score;
+
+		if (bVerbose)
+		{
+			printf("game %u: seed=%u frames=%u placed=%u lines=%u score=%u field_hash=%016llx\n", game, seed + game, result.frames,
+				result.placed, result.lines, result.score, (unsigned long long)result.fieldHash);
+		}
+	}
+
+	printf("games=%u frames=%llu placed=%llu lines=%llu avg_score=%.1f max_score=%u\n", numGames, totalFrames, totalPlaced,
+		totalLines, numGames ? (double)totalScore / numGames : 0.0, maxScore);
+	printf("time=%.3fs frames/s=%.0f games/s=%.1f threads=%u steals=%llu\n", seconds, seconds > 0.0 ? totalFrames / seconds : 0.0,
+		seconds > 0.0 ? numGames / seconds : 0.0, threadPool.GetNumThreads(), (unsigned long long)threadPool.GetNumSteals());
+
+	if (bAutoplay)
+	{
+		unsigned long long numSearches = 0;
+		unsigned long long numPlacementsEvaluated = 0;
+		double searchSeconds = 0.0;
+		double maxSearchSeconds = 0.0;
+		TranspositionTable::Stats tableStats = {};
+		for (const std::unique_ptr<WorkerState>& pWorker : workers)
+		{
+			const TranspositionTable::Stats workerTableStats = pWorker->autoPlayer.GetTranspositionTableStats();
+			tableStats.numProbes += workerTableStats.numProbes;
+			tableStats.numHits += workerTableStats.numHits;
+			tableStats.numStores += workerTableStats.numStores;
+			tableStats.numReplacements += workerTableStats.numReplacements;
+			tableStats.memoryBytes += workerTableStats.memoryBytes;
+
+			numSearches += pWorker->autoPlayer.GetNumSearches();
+			numPlacementsEvaluated += pWorker->autoPlayer.GetNumPlacementsEvaluated();
+			searchSeconds += pWorker->autoPlayer.GetSearchSeconds();
+			if (pWorker->autoPlayer.GetMaxSearchSeconds() > maxSearchSeconds)
+				maxSearchSeconds = pWorker->autoPlayer.GetMaxSearchSeconds();
+		}
+		printf("ai_depth=%u ai_beam=%u searches=%llu placements_evaluated=%llu search_us=%.3f max_search_us=%.3f\n",
+			autoPlayerSettings.searchDepth, autoPlayerSettings.beamWidth, numSearches, numPlacementsEvaluated,
+			numSearches ? searchSeconds * 1e6 / numSearches : 0.0, maxSearchSeconds * 1e6);
+		if (tableStats.memoryBytes > 0)
+		{
+			printf("tt_memory_mb=%.1f tt_probes=%llu tt_hits=%llu tt_hit_rate=%.4f tt_stores=%llu tt_replacements=%llu\n",
+				tableStats.memoryBytes / (1024.0 * 1024.0), tableStats.numProbes, tableStats.numHits,
+				tableStats.numProbes ? (double)tableStats.numHits / tableStats.numProbes : 0.0, tableStats.numStores,
+				tableStats.numReplacements);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,66 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    InputQueue.cpp
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "InputQueue.h"
+
+#include <chrono>
+
+static_assert((InputQueue::kCapacity & (InputQueue::kCapacity - 1)) == 0, "InputQueue::kCapacity must be a power of two");
+
+//--------------------------------------------------------------------------------------------------
+
+InputQueue::InputQueue()
+	: m_writeIndex(0)
+	, m_readIndex(0)
+{
+}
+
+bool InputQueue::Push(const InputRecord& record)
+{
+	const unsigned int writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+	if (writeIndex - m_readIndex.load(std::memory_order_acquire) == kCapacity)
+		return false;
+
+	m_records[writeIndex & (kCapacity - 1)] = record;
+	m_writeIndex.store(writeIndex + 1, std::memory_order_release);	// запись видна читателю только целиком
+	return true;
+}
+
+bool InputQueue::Pop(InputRecord& record)
+{
+	const unsigned int readIndex = m_readIndex.load(std::memory_order_relaxed);
+	if (readIndex == m_writeIndex.load(std::memory_order_acquire))
+		return false;
+
+	record = m_records[readIndex & (kCapacity - 1)];
+	m_readIndex.store(readIndex + 1, std::memory_order_release);	// ячейку можно переписывать
+	return true;
+}
+
+bool InputQueue::IsEmpty() const
+{
+	return m_readIndex.load(std::memory_order_relaxed) == m_writeIndex.load(std::memory_order_acquire);
+}
+
+void InputQueue::WakeReader()
+{
+	{
+		// читатель либо ещё не проверил очередь и увидит запись, либо уже ждёт и получит notify
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+	}
+	m_recordsPushed.notify_one();
+}
+
+bool InputQueue::WaitForRecords(unsigned int timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(m_wakeMutex);
+	return m_recordsPushed.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return !IsEmpty(); });
+}
+
+long long InputQueue::GetTimeMicroseconds()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
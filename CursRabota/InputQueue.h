@@ -0,0 +1,60 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    InputQueue.h
+**/
+//--------------------------------------------------------------------------------------------------
+
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include "Simulation.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+// ввод одного события SDL и момент, когда оно получено
+struct InputRecord
+{
+	long long		timeMicroseconds;	// InputQueue::GetTimeMicroseconds() при получении
+	unsigned int	eventTimestampMs;	// метка события SDL для замера задержки, 0 - не нажатие
+	GameInput		gameInput;			// bHoldLeft/bHoldRight - состояние клавиатуры сразу после события
+	bool			bQuit;
+	bool			bToggleProfiler;
+	bool			bRenderTargetsReset;
+};
+
+// Кольцо записей ввода без блокировок на одного писателя (поток событий) и одного читателя (поток игры).
+// Индексы растут без ограничений и берутся по маске, поэтому полная и пустая очередь различаются без лишней ячейки.
+// Сами Push и Pop без блокировок; мьютекс нужен только чтобы будить читателя, который спит в WaitForRecords
+class InputQueue
+{
+public:
+
+	static const unsigned int kCapacity = 256;	// степень двойки
+
+	InputQueue();
+
+	bool			Push(const InputRecord& record);	// только писатель; false - очередь полна, запись потеряна
+	bool			Pop(InputRecord& record);			// только читатель; false - очередь пуста
+	bool			IsEmpty() const;					// для читателя
+	void			WakeReader();						// только писатель, после Push
+	bool			WaitForRecords(unsigned int timeoutMs);	// для читателя; false - за timeoutMs ничего не пришло
+
+	static long long	GetTimeMicroseconds();	// часы для InputRecord::timeMicroseconds
+
+private:
+
+	InputQueue(const InputQueue&);
+	InputQueue& operator=(const InputQueue&);
+
+	InputRecord					m_records[kCapacity];
+	// индексы на разных строках кэша, чтобы писатель и читатель не мешали друг другу
+	std::atomic<unsigned int>	m_writeIndex;
+	char						m_padding[64];
+	std::atomic<unsigned int>	m_readIndex;
+	std::mutex					m_wakeMutex;
+	std::condition_variable		m_recordsPushed;
+};
+
+#endif // INPUT_QUEUE_H
@@ -0,0 +1,79 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    LatencyHistogram.cpp
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "LatencyHistogram.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const unsigned int s_kMaxBarLength = 50;
+
+//--------------------------------------------------------------------------------------------------
+
+LatencyHistogram::LatencyHistogram()
+	: m_numSamples(0)
+	, m_totalMs(0)
+	, m_maxMs(0)
+{
+	memset(m_buckets, 0, sizeof(m_buckets));
+}
+
+void LatencyHistogram::Add(unsigned int latencyMs)
+{
+	++m_buckets[latencyMs < kNumBuckets ? latencyMs : kNumBuckets - 1];
+	++m_numSamples;
+	m_totalMs += latencyMs;
+	m_maxMs = latencyMs > m_maxMs ? latencyMs : m_maxMs;
+}
+
+float LatencyHistogram::GetAverageMs() const
+{
+	return m_numSamples > 0 ? (float)m_totalMs / (float)m_numSamples : 0.0f;
+}
+
+unsigned int LatencyHistogram::GetPercentileMs(float percentile) const
+{
+	if (m_numSamples == 0)
+		return 0;
+
+	// наименьшая задержка, не меньше которой percentile процентов нажатий
+	const unsigned long long threshold = (unsigned long long)(percentile * 0.01f * m_numSamples + 0.5f);
+	unsigned long long count = 0;
+	for (unsigned int i = 0; i < kNumBuckets; ++i)
+	{
+		count += m_buckets[i];
+		if (count >= threshold && count > 0)
+			return i;
+	}
+	return kNumBuckets - 1;
+}
+
+void LatencyHistogram::Print() const
+{
+	printf("Input latency (key event -> Present): %u inputs, avg %.1f ms, p50 %u ms, p99 %u ms, max %u ms\n", m_numSamples,
+		GetAverageMs(), GetPercentileMs(50.0f), GetPercentileMs(99.0f), m_maxMs);
+	if (m_numSamples == 0)
+		return;
+
+	unsigned int maxBucket = 0;
+	for (unsigned int i = 0; i < kNumBuckets; ++i)
+	{
+		maxBucket = m_buckets[i] > maxBucket ? m_buckets[i] : maxBucket;
+	}
+
+	char bar[s_kMaxBarLength + 1];
+	for (unsigned int i = 0; i < kNumBuckets; ++i)
+	{
+		if (m_buckets[i] == 0)
+			continue;
+
+		const unsigned int barLength = (unsigned int)((unsigned long long)m_buckets[i] * s_kMaxBarLength / maxBucket);
+		memset(bar, '#', barLength);
+		bar[barLength] = '\0';
+		printf("%s%3u ms %6u %5.1f%% %s\n", i == kNumBuckets - 1 ? ">=" : "  ", i, m_buckets[i],
+			100.0f * m_buckets[i] / m_numSamples, bar);
+	}
+}
@@ -0,0 +1,37 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    LatencyHistogram.h
+**/
+//--------------------------------------------------------------------------------------------------
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+// Гистограмма задержки от нажатия клавиши (метка времени события SDL) до возврата из Present.
+// Метки SDL 2.0.14 в миллисекундах, поэтому корзины по 1 мс; последняя корзина - всё, что дольше
+class LatencyHistogram
+{
+public:
+
+	static const unsigned int kNumBuckets = 100;
+
+	LatencyHistogram();
+
+	void			Add(unsigned int latencyMs);
+
+	unsigned int	GetNumSamples() const { return m_numSamples; }
+	float			GetAverageMs() const;
+	unsigned int	GetPercentileMs(float percentile) const;	// percentile в [0, 100]
+	unsigned int	GetMaxMs() const { return m_maxMs; }
+
+	void			Print() const;	// непустые корзины в stdout
+
+private:
+
+	unsigned int		m_buckets[kNumBuckets];
+	unsigned int		m_numSamples;
+	unsigned long long	m_totalMs;
+	unsigned int		m_maxMs;
+};
+
+#endif // LATENCY_HISTOGRAM_H
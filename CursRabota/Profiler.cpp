@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    Profiler.cpp
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "Profiler.h"
+
+#include "Debug.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+static const char* s_stageNames[kNumProfileStages] =
+{
+	"Frame",
+	"Input",
+	"Update",
+	"Draw",
+	"Rects",
+	"Text",
+	"Textures",
+	"Present",
+};
+
+//--------------------------------------------------------------------------------------------------
+
+Profiler::Profiler()
+	: m_nextFrame(0)
+	, m_numFrames(0)
+{
+	BeginFrame();
+}
+
+const char* Profiler::GetStageName(ProfileStage stage)
+{
+	HP_ASSERT(stage < kNumProfileStages);
+	return s_stageNames[stage];
+}
+
+void Profiler::BeginFrame()
+{
+	for (unsigned int stage = 0; stage < kNumProfileStages; ++stage)
+	{
+		m_currentFrame[stage] = Clock::duration::zero();
+	}
+	m_frameStartTime = Clock::now();
+}
+
+void Profiler::EndFrame()
+{
+	m_currentFrame[kProfileStage_Frame] = Clock::now() - m_frameStartTime;
+
+	for (unsigned int stage = 0; stage < kNumProfileStages; ++stage)
+	{
+		m_frameTimesMs[m_nextFrame][stage] = std::chrono::duration<float, std::milli>(m_currentFrame[stage]).count();
+	}
+	m_nextFrame = (m_nextFrame + 1) % kMaxFrames;
+	if (m_numFrames < kMaxFrames)
+	{
+		++m_numFrames;
+	}
+
+	BeginFrame();
+}
+
+void Profiler::ComputeStats(StageStats stats[kNumProfileStages]) const
+{
+	float sortedMs[kMaxFrames];
+	for (unsigned int stage = 0; stage < kNumProfileStages; ++stage)
+	{
+		StageStats& stageStats = stats[stage];
+		stageStats = StageStats();
+		if (m_numFrames == 0)
+			continue;
+
+		float sumMs = 0.0f;
+		for (unsigned int i = 0; i < m_numFrames; ++i)
+		{
+			sortedMs[i] = m_frameTimesMs[i][stage];
+			sumMs += sortedMs[i];
+		}
+
+		// 99-й перцентиль - редкие пики, которых не видно в среднем
+		const unsigned int p99Index = (m_numFrames * 99) / 100;
+		std::nth_element(sortedMs, sortedMs + p99Index, sortedMs + m_numFrames);
+		stageStats.p99Ms = sortedMs[p99Index];
+		stageStats.minMs = *std::min_element(sortedMs, sortedMs + m_numFrames);
+		stageStats.maxMs = *std::max_element(sortedMs, sortedMs + m_numFrames);
+		stageStats.avgMs = sumMs / (float)m_numFrames;
+	}
+}
+
+bool Profiler::WriteCsv(const char* path) const
+{
+	FILE* pFile = fopen(path, "w");
+	if (!pFile)
+	{
+		fprintf(stderr, "Failed to open profile CSV for writing: %s\n", path);
+		return false;
+	}
+
+	fprintf(pFile, "frame");
+	for (unsigned int stage = 0; stage < kNumProfileStages; ++stage)
+	{
+		fprintf(pFile, ",%s_ms", s_stageNames[stage]);
+	}
+	fprintf(pFile, "\n");
+
+	// от самого старого кадра к самому новому
+	const unsigned int firstFrame = (m_nextFrame + kMaxFrames - m_numFrames) % kMaxFrames;
+	for (unsigned int i = 0; i < m_numFrames; ++i)
+	{
+		const float* frameTimesMs = m_frameTimesMs[(firstFrame + i) % kMaxFrames];
+		fprintf(pFile, "%u", i);
+		for (unsigned int stage = 0; stage < kNumProfileStages; ++stage)
+		{
+			fprintf(pFile, ",%.4f", frameTimesMs[stage]);
+		}
+		fprintf(pFile, "\n");
+	}
+
+	fclose(pFile);
+	printf("Profile written: %s (%u frames)\n", path, m_numFrames);
+	return true;
+}
@@ -0,0 +1,94 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    Profiler.h
+**/
+//--------------------------------------------------------------------------------------------------
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+
+// Этапы кадра. Render* замеряются внутри Renderer и входят во время Draw
+// (кроме последнего Flush перед Present), Frame - весь кадр от опроса ввода до Present
+enum ProfileStage
+{
+	kProfileStage_Frame = 0,
+	kProfileStage_Input,
+	kProfileStage_Update,
+	kProfileStage_Draw,
+	kProfileStage_RenderRects,
+	kProfileStage_RenderText,
+	kProfileStage_RenderTextures,
+	kProfileStage_Present,
+	kNumProfileStages
+};
+
+// Время этапов за последние kMaxFrames кадров: если этап вызывается за кадр несколько раз, время суммируется
+class Profiler
+{
+public:
+
+	static const unsigned int kMaxFrames = 1024;
+
+	struct StageStats
+	{
+		float	minMs;
+		float	avgMs;
+		float	p99Ms;
+		float	maxMs;
+	};
+
+	typedef std::chrono::high_resolution_clock Clock;
+
+	Profiler();
+
+	void			BeginFrame();
+	void			EndFrame();		// кадр попадает в кольцевой буфер; кадр без EndFrame отбрасывается
+	void			AddTime(ProfileStage stage, Clock::duration duration) { m_currentFrame[stage] += duration; }
+
+	unsigned int	GetNumFrames() const { return m_numFrames; }
+	void			ComputeStats(StageStats stats[kNumProfileStages]) const;
+	bool			WriteCsv(const char* path) const;
+
+	static const char*	GetStageName(ProfileStage stage);
+
+private:
+
+	Clock::time_point	m_frameStartTime;
+	Clock::duration		m_currentFrame[kNumProfileStages];
+	float				m_frameTimesMs[kMaxFrames][kNumProfileStages];
+	unsigned int		m_nextFrame;		// куда писать следующий кадр
+	unsigned int		m_numFrames;		// сколько кадров в буфере
+};
+
+// Замер времени до конца области видимости; без профайлера ничего не делает
+class ProfileScope
+{
+public:
+
+	ProfileScope(Profiler* pProfiler, ProfileStage stage)
+		: m_pProfiler(pProfiler)
+		, m_stage(stage)
+	{
+		if (m_pProfiler)
+			m_startTime = Profiler::Clock::now();
+	}
+
+	~ProfileScope()
+	{
+		if (m_pProfiler)
+			m_pProfiler->AddTime(m_stage, Profiler::Clock::now() - m_startTime);
+	}
+
+private:
+
+	ProfileScope(const ProfileScope&);
+	ProfileScope& operator=(const ProfileScope&);
+
+	Profiler*			m_pProfiler;
+	ProfileStage		m_stage;
+	Profiler::Clock::time_point	m_startTime;
+};
+
+#endif // PROFILER_H
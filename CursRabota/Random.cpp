@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    Random.cpp
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "Random.h"
+
+//--------------------------------------------------------------------------------------------------
+// хелперы
+
+static uint32_t RotateLeft(uint32_t x, int k)
+{
+	return (x << k) | (x >> (32 - k));
+}
+
+// splitmix64 разворачивает зерно в состояние, в котором нет одних нулей
+static uint64_t SplitMix64(uint64_t& state)
+{
+	uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Random::Random()
+{
+	Seed(0);
+}
+
+Random::Random(uint64_t seed)
+{
+	Seed(seed);
+}
+
+void Random::Seed(uint64_t seed)
+{
+	uint64_t splitMixState = seed;
+	const uint64_t a = SplitMix64(splitMixState);
+	const uint64_t b = SplitMix64(splitMixState);
+	m_state[0] = (uint32_t)a;
+	m_state[1] = (uint32_t)(a >> 32);
+	m_state[2] = (uint32_t)b;
+	m_state[3] = (uint32_t)(b >> 32);
+}
+
+uint32_t Random::Next()
+{
+	const uint32_t result = RotateLeft(m_state[1] * 5, 7) * 9;
+	const uint32_t t = m_state[1] << 9;
+
+	m_state[2] ^= m_state[0];
+	m_state[3] ^= m_state[1];
+	m_state[1] ^= m_state[2];
+	m_state[0] ^= m_state[3];
+	m_state[2] ^= t;
+	m_state[3] = RotateLeft(m_state[3], 11);
+
+	return result;
+}
+
+uint32_t Random::NextBelow(uint32_t bound)
+{
+	// умножение вместо деления: смещение для маленьких bound пренебрежимо мало
+	return (uint32_t)(((uint64_t)Next() * bound) >> 32);
+}
@@ -0,0 +1,30 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    Random.h
+**/
+//--------------------------------------------------------------------------------------------------
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+// Генератор случайных чисел xoshiro128** со своим состоянием: у каждой партии свой генератор,
+// одинаковое зерно даёт одинаковую последовательность на любой платформе и в любом потоке
+class Random
+{
+public:
+
+	Random();
+	explicit Random(uint64_t seed);
+
+	void			Seed(uint64_t seed);
+	uint32_t		Next();
+	uint32_t		NextBelow(uint32_t bound);	// [0, bound)
+
+private:
+
+	uint32_t m_state[4];
+};
+
+#endif // RANDOM_H
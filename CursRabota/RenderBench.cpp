@@ -0,0 +1,188 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    RenderBench.cpp
+
+	Замер стоимости отрисовки без окна и без GPU: Renderer рисует программно в SDL_Surface,
+	Game проводится по всем экранам через обычный ввод. Работает на Linux без дисплея
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "Game.h"
+#include "Renderer.h"
+
+#include "SDL.h"
+#include "SDL_ttf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+static const unsigned int s_kLogicalWidth = 1280;
+static const unsigned int s_kLogicalHeight = 720;
+static const float s_kFrameSeconds = 1.0f / 60.0f;
+
+struct ScreenResult
+{
+	const char*		name;
+	unsigned int	numFrames;
+	double			totalMs;
+	double			minMs;
+	double			maxMs;
+	unsigned int	drawCalls;		// за последний кадр
+	unsigned int	numRects;
+};
+
+static void SendInput(Game& game, bool GameInput::* pButton)
+{
+	GameInput gameInput = {};
+	if (pButton)
+	{
+		gameInput.*pButton = true;
+	}
+	game.Update(gameInput, s_kFrameSeconds);
+}
+
+// кадры одного экрана: Clear + Game::Draw + Present под таймером, Update (если нужен) - вне таймера
+static void MeasureScreen(Game& game, Renderer& renderer, const char* name, unsigned int numFrames, bool bUpdate, ScreenResult& result)
+{
+	result.name = name;
+	result.numFrames = numFrames;
+	result.totalMs = 0.0;
+	result.minMs = 1e30;
+	result.maxMs = 0.0;
+
+	for (unsigned int frame = 0; frame < numFrames; ++frame)
+	{
+		if (bUpdate)
+		{
+			SendInput(game, nullptr);
+		}
+
+		const BenchClock::time_point startTime = BenchClock::now();
+		renderer.Clear();
+		game.Draw(renderer);
+		renderer.Present();
+		const double frameMs = std::chrono::duration<double, std::milli>(BenchClock::now() - startTime).count();
+
+		result.totalMs += frameMs;
+		result.minMs = frameMs < result.minMs ? frameMs : result.minMs;
+		result.maxMs = frameMs > result.maxMs ? frameMs : result.maxMs;
+	}
+
+	result.drawCalls = renderer.GetFrameStats().drawCalls;
+	result.numRects = renderer.GetFrameStats().numRects;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int numFrames = 300;
+	unsigned int seed = 1;
+	const char* pOutputPath = nullptr;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			numFrames = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			pOutputPath = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--frames N] [--seed S] [--out file.json]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// видеоподсистема не нужна: рисуем в поверхность программным рендерером
+	if (SDL_Init(0) != 0 || TTF_Init() == -1)
+	{
+		fprintf(stderr, "SDL/TTF failed to initialise: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	SDL_Surface* pSurface = SDL_CreateRGBSurfaceWithFormat(0, s_kLogicalWidth, s_kLogicalHeight, 32, SDL_PIXELFORMAT_RGBA8888);
+	if (!pSurface)
+	{
+		fprintf(stderr, "SDL_CreateRGBSurfaceWithFormat failed: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	ScreenResult results[6];
+	unsigned int numResults = 0;
+	{
+		Renderer renderer(*pSurface, s_kLogicalWidth, s_kLogicalHeight);
+		Game game;
+		game.Init(seed, nullptr, nullptr);
+
+		// первый кадр растеризует строки в кэш текста - его не считаем
+		renderer.Clear();
+		game.Draw(renderer);
+		renderer.Present();
+
+		MeasureScreen(game, renderer, "title", numFrames, false, results[numResults++]);
+
+		SendInput(game, &GameInput::Rules);
+		MeasureScreen(game, renderer, "rules", numFrames, false, results[numResults++]);
+		SendInput(game, &GameInput::bStart);
+
+		SendInput(game, &GameInput::WatchHighScore);
+		MeasureScreen(game, renderer, "high_score", numFrames, false, results[numResults++]);
+		SendInput(game, &GameInput::bStart);
+
+		// немного заполняем поле, чтобы рисовались не только пустые клетки
+		SendInput(game, &GameInput::bStart);
+		for (unsigned int i = 0; i < 12; ++i)
+		{
+			SendInput(game, (i % 3 == 0) ? &GameInput::bMoveLeft : (i % 3 == 1) ? &GameInput::bMoveRight : &GameInput::bHardDrop);
+		}
+		MeasureScreen(game, renderer, "playing", numFrames, true, results[numResults++]);
+
+		SendInput(game, &GameInput::bPause);
+		MeasureScreen(game, renderer, "pause", numFrames, false, results[numResults++]);
+		SendInput(game, &GameInput::bStart);
+
+		for (unsigned int i = 0; i < 1000 && !game.IsStatic(); ++i)
+		{
+			SendInput(game, &GameInput::bHardDrop);
+		}
+		MeasureScreen(game, renderer, "game_over", numFrames, false, results[numResults++]);
+
+		game.Shutdown();
+	}
+
+	SDL_FreeSurface(pSurface);
+	TTF_Quit();
+	SDL_Quit();
+
+	FILE* pFile = pOutputPath ? fopen(pOutputPath, "w") : stdout;
+	if (!pFile)
+	{
+		fprintf(stderr, "Failed to open output file: %s\n", pOutputPath);
+		return 1;
+	}
+	fprintf(pFile, "{\n  \"renderer\": \"software\",\n  \"width\": %u,\n  \"height\": %u,\n  \"frames_per_screen\": %u,\n  \"screens\": [\n",
+		s_kLogicalWidth, s_kLogicalHeight, numFrames);
+	for (unsigned int i = 0; i < numResults; ++i)
+	{
+		const ScreenResult& result = results[i];
+		const double avgMs = result.numFrames ? result.totalMs / result.numFrames : 0.0;
+		fprintf(pFile, "    { \"screen\": \"%s\", \"fps\": %.1f, \"avg_ms\": %.4f, \"min_ms\": %.4f, \"max_ms\": %.4f, \"draw_calls\": %u, \"rects\": %u }%s\n",
+			result.name, avgMs > 0.0 ? 1000.0 / avgMs : 0.0, avgMs, result.minMs, result.maxMs, result.drawCalls, result.numRects,
+			i + 1 < numResults ? "," : "");
+	}
+	fprintf(pFile, "  ]\n}\n");
+	if (pFile != stdout)
+	{
+		fclose(pFile);
+	}
+	return 0;
+}
@@ -7,13 +7,17 @@
 #include "Renderer.h"
 
 #include "Debug.h"
+#include "GlyphAtlas.h"
+#include "Profiler.h"
 
 #include "SDL.h"
 
 #include <stdio.h>
 
+static const size_t s_kTextCacheMaxBytes = 8 * 1024 * 1024;	// лимит памяти текстур строк
+
 //--------------------------------------------------------------------------------------------------
-// 
+// хелперы
 
 static SDL_Color MakeSDL_Colour(uint32_t rgba)
 {
@@ -38,11 +42,20 @@ static void PrintRendererInfo(SDL_RendererInfo& rendererInfo)
 
 //--------------------------------------------------------------------------------------------------
 
-Renderer::Renderer(SDL_Window& window, unsigned int logicalWidth, unsigned int logicalHeight)
+Renderer::Renderer(SDL_Window& window, unsigned int logicalWidth, unsigned int logicalHeight, bool bVsync)
 	: m_logicalWidth(0)
 	, m_logicalHeight(0)
 	, m_pSdlRenderer(nullptr)
 	, m_pFont(nullptr)
+	, m_pTextCache(nullptr)
+	, m_pGlyphAtlas(nullptr)
+	, m_renderTargetGeneration(0)
+	, m_numPendingRects(0)
+	, m_lastBatchIndex(0)
+	, m_currentDrawRgba(0)
+	, m_bDrawColorValid(false)
+	, m_pProfiler(nullptr)
+	, m_bSyncAfterPresent(false)
 {
 	int numRenderDrivers = SDL_GetNumRenderDrivers();
 	printf("%d render drivers:\n", numRenderDrivers);
@@ -54,7 +67,11 @@ Renderer::Renderer(SDL_Window& window, unsigned int logicalWidth, unsigned int l
 		PrintRendererInfo(rendererInfo);
 	}
 
-	Uint32 rendererFlags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC;
+	Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+	if (bVsync)
+	{
+		rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+	}
 	m_pSdlRenderer = SDL_CreateRenderer(&window, -1, rendererFlags);
 	if (!m_pSdlRenderer)
 	{
@@ -62,16 +79,9 @@ Renderer::Renderer(SDL_Window& window, unsigned int logicalWidth, unsigned int l
 		HP_FATAL_ERROR("Failed to create SDL renderer");
 	}
 
-	SDL_RendererInfo rendererInfo;
-	if (SDL_GetRendererInfo(m_pSdlRenderer, &rendererInfo) != 0)
-	{
-		fprintf(stderr, "SDL_GetRendererInfo failed: %s\n", SDL_GetError());
-		HP_FATAL_ERROR("SDL_GetRendererInfo failed");
-	}
-	printf("Created renderer:\n");
-	PrintRendererInfo(rendererInfo);
+	Init(logicalWidth, logicalHeight);
 
-	//       !!
+	// Размер дисплея может не соответствовать логическому размеру!!
 	int displayWidth, displayHeight;
 	SDL_GetWindowSize(&window, &displayWidth, &displayHeight);
 	printf("Display size = (%d, %d)\n", displayWidth, displayHeight);
@@ -86,69 +96,299 @@ Renderer::Renderer(SDL_Window& window, unsigned int logicalWidth, unsigned int l
 	{
 		printf("Logical aspect != display aspect. Letterboxing will be applied\n");
 	}
+}
+
+Renderer::Renderer(SDL_Surface& surface, unsigned int logicalWidth, unsigned int logicalHeight)
+	: m_logicalWidth(0)
+	, m_logicalHeight(0)
+	, m_pSdlRenderer(nullptr)
+	, m_pFont(nullptr)
+	, m_pTextCache(nullptr)
+	, m_pGlyphAtlas(nullptr)
+	, m_renderTargetGeneration(0)
+	, m_numPendingRects(0)
+	, m_lastBatchIndex(0)
+	, m_currentDrawRgba(0)
+	, m_bDrawColorValid(false)
+	, m_pProfiler(nullptr)
+	, m_bSyncAfterPresent(false)
+{
+	m_pSdlRenderer = SDL_CreateSoftwareRenderer(&surface);
+	if (!m_pSdlRenderer)
+	{
+		fprintf(stderr, "SDL_CreateSoftwareRenderer failed: %s\n", SDL_GetError());
+		HP_FATAL_ERROR("Failed to create SDL software renderer");
+	}
+
+	Init(logicalWidth, logicalHeight);
+}
+
+// общая часть конструкторов: рендерер SDL уже создан
+void Renderer::Init(unsigned int logicalWidth, unsigned int logicalHeight)
+{
+	m_frameStats = FrameStats();
+	m_lastFrameStats = FrameStats();
+
+	SDL_RendererInfo rendererInfo;
+	if (SDL_GetRendererInfo(m_pSdlRenderer, &rendererInfo) != 0)
+	{
+		fprintf(stderr, "SDL_GetRendererInfo failed: %s\n", SDL_GetError());
+		HP_FATAL_ERROR("SDL_GetRendererInfo failed");
+	}
+	printf("Created renderer:\n");
+	PrintRendererInfo(rendererInfo);
 
 	m_logicalWidth = logicalWidth;
 	m_logicalHeight = logicalHeight;
 	SDL_RenderSetLogicalSize(m_pSdlRenderer, logicalWidth, logicalHeight);
 
-	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");  //     
+	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");  // делаем масштабированный рендеринг более плавным
 
 	int defaultFontSize = 32;
-	m_pFont = TTF_OpenFont("courier.ttf", defaultFontSize); //    
+	m_pFont = TTF_OpenFont("courier.ttf", defaultFontSize); // подключаем наш шрифт 
 	if (!m_pFont)
 	{
 		fprintf(stderr, "TTF_OpenFont failed: %s\n", TTF_GetError());
 		HP_FATAL_ERROR("Failed to open font")
 	} 
+
+	m_pTextCache = new TextCache(*m_pSdlRenderer, *m_pFont, s_kTextCacheMaxBytes);
+	m_pGlyphAtlas = new GlyphAtlas(*m_pSdlRenderer, *m_pFont);
 }
 
 Renderer::~Renderer()
 {
+	const TextCache::Stats& stats = m_pTextCache->GetStats();
+	printf("Text cache: hits=%u misses=%u evictions=%u entries=%u bytes=%u\n",
+		stats.totalHits, stats.totalMisses, stats.totalEvictions, stats.numEntries, (unsigned int)stats.bytesUsed);
+	printf("Last frame: draw calls=%u state changes=%u rects=%u\n",
+		m_lastFrameStats.drawCalls, m_lastFrameStats.stateChanges, m_lastFrameStats.numRects);
+	for (SDL_Texture* pTexture : m_renderTargets)
+	{
+		SDL_DestroyTexture(pTexture);
+	}
+	delete m_pGlyphAtlas;
+	delete m_pTextCache;
 	TTF_CloseFont(m_pFont);
 	SDL_DestroyRenderer(m_pSdlRenderer);
 }
 
 void Renderer::Clear()
 {
-	SDL_SetRenderDrawColor(m_pSdlRenderer, 0, 0, 0, 255);
+	HP_TRACE_SCOPE("Renderer::Clear");
+	// всё, что не успели вывести до очистки, всё равно было бы стёрто
+	for (RectBatch& batch : m_rectBatches)
+	{
+		batch.rects.clear();
+	}
+	m_numPendingRects = 0;
+
+	SetDrawColor(0x000000ff);
 	SDL_RenderClear(m_pSdlRenderer);
+	++m_frameStats.drawCalls;
 }
 
 void Renderer::Present()
 {
-	SDL_RenderPresent(m_pSdlRenderer);
+	HP_TRACE_SCOPE("Renderer::Present");
+	Flush();
+	{
+		ProfileScope profileScope(m_pProfiler, kProfileStage_Present);
+		SDL_RenderPresent(m_pSdlRenderer);
+		if (m_bSyncAfterPresent)
+		{
+			// чтение блокирует до конца отрисовки, так в очереди драйвера не больше одного кадра
+			SDL_Rect pixelRect = { 0, 0, 1, 1 };
+			Uint32 pixel;
+			SDL_RenderReadPixels(m_pSdlRenderer, &pixelRect, SDL_PIXELFORMAT_RGBA8888, &pixel, sizeof(pixel));
+		}
+	}
+	m_pTextCache->EndFrame();
+
+	m_lastFrameStats = m_frameStats;
+	m_frameStats = FrameStats();
+	m_bDrawColorValid = false;	// после Present состояние рендерера SDL не гарантируется
 }
 
-void Renderer::DrawRect(int x, int y, int w, int h, uint32_t rgba /*= 0xffffffff */)
+void Renderer::Flush()
 {
-	SDL_Color color = MakeSDL_Colour(rgba);
-	SDL_SetRenderDrawColor(m_pSdlRenderer, color.r, color.g, color.b, color.a);
+	HP_TRACE_SCOPE("Renderer::Flush");
+	if (m_numPendingRects == 0)
+		return;
 
-	SDL_Rect rect = { x, y, w, h };
-	SDL_RenderDrawRect(m_pSdlRenderer, &rect);
+	ProfileScope profileScope(m_pProfiler, kProfileStage_RenderRects);
+
+	// сначала заливки, потом рамки поверх них
+	for (unsigned int pass = 0; pass < 2; ++pass)
+	{
+		const bool bFilled = (pass == 0);
+		for (RectBatch& batch : m_rectBatches)
+		{
+			if (batch.bFilled != bFilled || batch.rects.empty())
+				continue;
+
+			SetDrawColor(batch.rgba);
+			if (bFilled)
+			{
+				SDL_RenderFillRects(m_pSdlRenderer, batch.rects.data(), (int)batch.rects.size());
+			}
+			else
+			{
+				SDL_RenderDrawRects(m_pSdlRenderer, batch.rects.data(), (int)batch.rects.size());
+			}
+			++m_frameStats.drawCalls;
+			batch.rects.clear();
+		}
+	}
+	m_numPendingRects = 0;
 }
 
-void Renderer::DrawSolidRect(int x, int y, int w, int h, uint32_t rgba /*= 0xffffffff */)
+void Renderer::DrawRect(int x, int y, int w, int h, uint32_t rgba /*= 0xffffffff */)
 {
-	SDL_Color color = MakeSDL_Colour(rgba);
-	SDL_SetRenderDrawColor(m_pSdlRenderer, color.r, color.g, color.b, color.a);
+	AddRect(x, y, w, h, rgba, false);
+}
 
-	SDL_Rect rect = { x, y, w, h };
-	SDL_RenderFillRect(m_pSdlRenderer, &rect);
+void Renderer::DrawSolidRect(int x, int y, int w, int h, uint32_t rgba /*= 0xffffffff */)
+{
+	AddRect(x, y, w, h, rgba, true);
 }
 
 void Renderer::DrawText(const char* text, int x, int y, uint32_t rgba /*= 0xffffffff */)
 {
+	HP_TRACE_SCOPE("Renderer::DrawText");
 	SDL_assert(text);
 
-	SDL_Color color = MakeSDL_Colour(rgba);
+	Flush();
+
+	ProfileScope profileScope(m_pProfiler, kProfileStage_RenderText);
+
+	int width, height;
+	SDL_Texture* pTexture = m_pTextCache->Get(text, rgba, width, height);
+	if (!pTexture)
+		return;
+
+	SDL_Rect dstRect = { x, y, width, height };
+	SDL_RenderCopy(m_pSdlRenderer, pTexture, nullptr, &dstRect);
+	++m_frameStats.drawCalls;
+}
+
+void Renderer::DrawDynamicText(const char* text, int x, int y, uint32_t rgba /*= 0xffffffff */)
+{
+	HP_TRACE_SCOPE("Renderer::DrawDynamicText");
+	if (!m_pGlyphAtlas->IsValid())
+	{
+		DrawText(text, x, y, rgba);
+		return;
+	}
+
+	Flush();
+
+	ProfileScope profileScope(m_pProfiler, kProfileStage_RenderText);
+	m_pGlyphAtlas->DrawText(text, x, y, rgba);
+	m_frameStats.drawCalls += m_pGlyphAtlas->GetLastNumDrawCalls();
+	++m_frameStats.stateChanges;
+}
+
+SDL_Texture* Renderer::CreateRenderTarget(unsigned int width, unsigned int height)
+{
+	HP_TRACE_SCOPE("Renderer::CreateRenderTarget");
+	if (!SDL_RenderTargetSupported(m_pSdlRenderer))
+		return nullptr;
+
+	SDL_Texture* pTexture = SDL_CreateTexture(m_pSdlRenderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+	if (!pTexture)
+	{
+		fprintf(stderr, "SDL_CreateTexture failed: %s\n", SDL_GetError());
+		return nullptr;
+	}
+
+	SDL_SetTextureBlendMode(pTexture, SDL_BLENDMODE_NONE);
+	m_renderTargets.push_back(pTexture);
+	return pTexture;
+}
+
+void Renderer::DestroyRenderTarget(SDL_Texture* pTexture)
+{
+	for (size_t i = 0; i < m_renderTargets.size(); ++i)
+	{
+		if (m_renderTargets[i] == pTexture)
+		{
+			m_renderTargets[i] = m_renderTargets.back();
+			m_renderTargets.pop_back();
+			SDL_DestroyTexture(pTexture);
+			return;
+		}
+	}
+	HP_FATAL_ERROR("Unknown render target");
+}
+
+void Renderer::SetRenderTarget(SDL_Texture* pTexture)
+{
+	HP_TRACE_SCOPE("Renderer::SetRenderTarget");
+	Flush();
+
+	ProfileScope profileScope(m_pProfiler, kProfileStage_RenderTextures);
+	SDL_SetRenderTarget(m_pSdlRenderer, pTexture);
+	++m_frameStats.stateChanges;
+}
+
+void Renderer::DrawTexture(SDL_Texture* pTexture, int x, int y)
+{
+	HP_TRACE_SCOPE("Renderer::DrawTexture");
+	SDL_assert(pTexture);
+
+	Flush();
+
+	ProfileScope profileScope(m_pProfiler, kProfileStage_RenderTextures);
 
-	SDL_Surface* pSurface = TTF_RenderText_Blended(m_pFont, text, color);
-	SDL_Texture* pTexture = SDL_CreateTextureFromSurface(m_pSdlRenderer, pSurface);
 	int width, height;
 	SDL_QueryTexture(pTexture, NULL, NULL, &width, &height);
 	SDL_Rect dstRect = { x, y, width, height };
 	SDL_RenderCopy(m_pSdlRenderer, pTexture, nullptr, &dstRect);
-	SDL_DestroyTexture(pTexture);
-	SDL_FreeSurface(pSurface);
-}
\ No newline at end of file
+	++m_frameStats.drawCalls;
+}
+
+void Renderer::OnRenderTargetsReset()
+{
+	++m_renderTargetGeneration;
+}
+
+void Renderer::AddRect(int x, int y, int w, int h, uint32_t rgba, bool bFilled)
+{
+	// обычно подряд идут прямоугольники одного цвета, поэтому сначала проверяем последний пакет
+	unsigned int batchIndex = m_lastBatchIndex;
+	if (batchIndex >= m_rectBatches.size() || m_rectBatches[batchIndex].rgba != rgba || m_rectBatches[batchIndex].bFilled != bFilled)
+	{
+		batchIndex = 0;
+		while (batchIndex < m_rectBatches.size() && (m_rectBatches[batchIndex].rgba != rgba || m_rectBatches[batchIndex].bFilled != bFilled))
+		{
+			++batchIndex;
+		}
+
+		if (batchIndex == m_rectBatches.size())
+		{
+			RectBatch batch;
+			batch.rgba = rgba;
+			batch.bFilled = bFilled;
+			m_rectBatches.push_back(batch);
+		}
+		m_lastBatchIndex = batchIndex;
+	}
+
+	SDL_Rect rect = { x, y, w, h };
+	m_rectBatches[batchIndex].rects.push_back(rect);
+	++m_numPendingRects;
+	++m_frameStats.numRects;
+}
+
+void Renderer::SetDrawColor(uint32_t rgba)
+{
+	if (m_bDrawColorValid && m_currentDrawRgba == rgba)
+		return;
+
+	SDL_Color color = MakeSDL_Colour(rgba);
+	SDL_SetRenderDrawColor(m_pSdlRenderer, color.r, color.g, color.b, color.a);
+	m_currentDrawRgba = rgba;
+	m_bDrawColorValid = true;
+	++m_frameStats.stateChanges;
+}
@@ -8,22 +8,41 @@
 #define RENDERER_H
 
 #include "SDL_ttf.h"
+#include "TextCache.h"
 
+#include <vector>
+
+class GlyphAtlas;
+class Profiler;
 
 
 // SDL forward
 struct SDL_Window;
+struct SDL_Surface;
 struct SDL_Renderer;
+struct SDL_Texture;
 
+// DrawRect/DrawSolidRect не рисуют сразу: прямоугольники копятся по цветам и выводятся пакетами
+// в Flush() (вызывается также из DrawText и Present). Внутри пакета сначала идут все заливки, потом все рамки,
+// порядок между разными цветами не сохраняется - если прямоугольники перекрываются, нужно звать Flush() между ними
 class Renderer
 {
 public:
 
-	Renderer(SDL_Window& window, unsigned int logicalWidth, unsigned int logicalHeight);
+	struct FrameStats
+	{
+		unsigned int	drawCalls;		// вызовы отрисовки SDL
+		unsigned int	stateChanges;	// смены цвета/состояния SDL
+		unsigned int	numRects;		// прямоугольников отправлено
+	};
+
+	Renderer(SDL_Window& window, unsigned int logicalWidth, unsigned int logicalHeight, bool bVsync = true);
+	Renderer(SDL_Surface& surface, unsigned int logicalWidth, unsigned int logicalHeight);	// программный рендеринг в поверхность, без окна и GPU
 	~Renderer();
 
 	void			Clear();//
 	void			Present();// 
+	void			Flush();// выводит накопленные прямоугольники
 
 	unsigned int	GetLogicalWidth() const { return m_logicalWidth; }//
 	unsigned int	GetLogicalHeight() const { return m_logicalHeight; }//
@@ -31,15 +50,60 @@ public:
 	void			DrawRect(int x, int y, int w, int h, uint32_t rgba = 0xffffffff);//
 	void			DrawSolidRect(int x, int y, int w, int h, uint32_t rgba = 0xffffffff);//
 	void			DrawText(const char* text, int x, int y, uint32_t rgba = 0xffffffff);//
+	void			DrawDynamicText(const char* text, int x, int y, uint32_t rgba = 0xffffffff);// для строк, меняющихся каждый кадр (счёт, FPS)
+
+	// Текстуры, в которые можно рисовать. nullptr, если рендерер их не поддерживает
+	SDL_Texture*	CreateRenderTarget(unsigned int width, unsigned int height);
+	void			DestroyRenderTarget(SDL_Texture* pTexture);
+	void			SetRenderTarget(SDL_Texture* pTexture);// nullptr = экран
+	void			DrawTexture(SDL_Texture* pTexture, int x, int y);
+	// Меняется, когда содержимое текстур-целей потеряно (сброс устройства) и их нужно перерисовать
+	unsigned int	GetRenderTargetGeneration() const { return m_renderTargetGeneration; }
+	void			OnRenderTargetsReset();
+
+	const TextCache::Stats&	GetTextCacheStats() const { return m_pTextCache->GetStats(); }
+	const FrameStats&		GetFrameStats() const { return m_lastFrameStats; }	// за последний завершённый кадр
+
+	void			SetProfiler(Profiler* pProfiler) { m_pProfiler = pProfiler; }	// nullptr - не замерять
+	// после Present читать пиксель с экрана: ждём, пока GPU закончит кадр, и драйвер не копит кадры впереди
+	void			SetSyncAfterPresent(bool bSyncAfterPresent) { m_bSyncAfterPresent = bSyncAfterPresent; }
 
 private:
 
+	struct RectBatch
+	{
+		uint32_t			rgba;
+		bool				bFilled;
+		std::vector<SDL_Rect>	rects;
+	};
+
+	void			Init(unsigned int logicalWidth, unsigned int logicalHeight);
+	void			AddRect(int x, int y, int w, int h, uint32_t rgba, bool bFilled);
+	void			SetDrawColor(uint32_t rgba);
+
 	unsigned int	m_logicalWidth;
 	unsigned int	m_logicalHeight;
 
 	SDL_Renderer*	m_pSdlRenderer;
 
 	TTF_Font*		m_pFont;
+	TextCache*		m_pTextCache;
+	GlyphAtlas*		m_pGlyphAtlas;
+
+	std::vector<SDL_Texture*>	m_renderTargets;
+	unsigned int	m_renderTargetGeneration;
+
+	std::vector<RectBatch>	m_rectBatches;	// не удаляются между кадрами, чтобы не выделять память
+	unsigned int	m_numPendingRects;
+	unsigned int	m_lastBatchIndex;
+	uint32_t		m_currentDrawRgba;
+	bool			m_bDrawColorValid;
+
+	FrameStats		m_frameStats;
+	FrameStats		m_lastFrameStats;
+
+	Profiler*		m_pProfiler;
+	bool			m_bSyncAfterPresent;
 };
 
 #endif // RENDERER_H
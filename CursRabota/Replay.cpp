@@ -0,0 +1,347 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    Replay.cpp
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "Replay.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const uint8_t s_kReplayMagic[4] = { 'T', 'R', 'P', 'L' };
+static const uint32_t s_kReplayVersion = 3;
+static const uint32_t s_kReplayVersionNoFieldSize = 2;	// поле 10x20 без скрытых строк
+static const uint32_t s_kReplayVersionNoAutoShift = 1;	// без настроек автосдвига: в таких записях клавиши не зажимаются
+static const size_t s_kReplayHeaderSize = 36;
+static const size_t s_kReplayHeaderSizeNoFieldSize = 24;
+static const size_t s_kReplayHeaderSizeNoAutoShift = 16;
+
+// поле, на котором записаны версии 1 и 2
+static FieldSize GetLegacyFieldSize()
+{
+	FieldSize fieldSize;
+	fieldSize.width = 10;
+	fieldSize.height = 20;
+	fieldSize.numHiddenRows = 0;
+	return fieldSize;
+}
+
+enum GameInputBit
+{
+	kGameInputBit_MoveLeft = 0,
+	kGameInputBit_MoveRight,
+	kGameInputBit_RotateClockwise,
+	kGameInputBit_RotateAnticlockwise,
+	kGameInputBit_HardDrop,
+	kGameInputBit_SoftDrop,
+	kGameInputBit_DebugChangeTetromino,
+	kGameInputBit_DebugMoveLeft,
+	kGameInputBit_DebugMoveRight,
+	kGameInputBit_DebugMoveUp,
+	kGameInputBit_DebugMoveDown,
+	kGameInputBit_HoldLeft,
+	kGameInputBit_HoldRight,
+};
+
+//--------------------------------------------------------------------------------------------------
+// хелперы
+
+static void WriteUint32(std::vector<uint8_t>& data, uint32_t value)
+{
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		data.push_back((uint8_t)(value >> (i * 8)));
+	}
+}
+
+static uint32_t ReadUint32(const uint8_t* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// 7 бит на байт, старший бит - "дальше есть ещё байт"
+static void WriteVarint(std::vector<uint8_t>& data, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		data.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	data.push_back((uint8_t)value);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint16_t PackGameInput(const GameInput& gameInput)
+{
+	uint16_t bits = 0;
+	bits |= gameInput.bMoveLeft ? (1 << kGameInputBit_MoveLeft) : 0;
+	bits |= gameInput.bMoveRight ? (1 << kGameInputBit_MoveRight) : 0;
+	bits |= gameInput.bRotateClockwise ? (1 << kGameInputBit_RotateClockwise) : 0;
+	bits |= gameInput.bRotateAnticlockwise ? (1 << kGameInputBit_RotateAnticlockwise) : 0;
+	bits |= gameInput.bHardDrop ? (1 << kGameInputBit_HardDrop) : 0;
+	bits |= gameInput.bSoftDrop ? (1 << kGameInputBit_SoftDrop) : 0;
+	bits |= gameInput.bHoldLeft ? (1 << kGameInputBit_HoldLeft) : 0;
+	bits |= gameInput.bHoldRight ? (1 << kGameInputBit_HoldRight) : 0;
+#ifdef _DEBUG
+	bits |= gameInput.bDebugChangeTetromino ? (1 << kGameInputBit_DebugChangeTetromino) : 0;
+	bits |= gameInput.bDebugMoveLeft ? (1 << kGameInputBit_DebugMoveLeft) : 0;
+	bits |= gameInput.bDebugMoveRight ? (1 << kGameInputBit_DebugMoveRight) : 0;
+	bits |= gameInput.bDebugMoveUp ? (1 << kGameInputBit_DebugMoveUp) : 0;
+	bits |= gameInput.bDebugMoveDown ? (1 << kGameInputBit_DebugMoveDown) : 0;
+#endif
+	return bits;
+}
+
+void UnpackGameInput(uint16_t bits, GameInput& gameInput)
+{
+	gameInput = GameInput();
+	gameInput.bMoveLeft = (bits & (1 << kGameInputBit_MoveLeft)) != 0;
+	gameInput.bMoveRight = (bits & (1 << kGameInputBit_MoveRight)) != 0;
+	gameInput.bRotateClockwise = (bits & (1 << kGameInputBit_RotateClockwise)) != 0;
+	gameInput.bRotateAnticlockwise = (bits & (1 << kGameInputBit_RotateAnticlockwise)) != 0;
+	gameInput.bHardDrop = (bits & (1 << kGameInputBit_HardDrop)) != 0;
+	gameInput.bSoftDrop = (bits & (1 << kGameInputBit_SoftDrop)) != 0;
+	gameInput.bHoldLeft = (bits & (1 << kGameInputBit_HoldLeft)) != 0;
+	gameInput.bHoldRight = (bits & (1 << kGameInputBit_HoldRight)) != 0;
+#ifdef _DEBUG
+	gameInput.bDebugChangeTetromino = (bits & (1 << kGameInputBit_DebugChangeTetromino)) != 0;
+	gameInput.bDebugMoveLeft = (bits & (1 << kGameInputBit_DebugMoveLeft)) != 0;
+	gameInput.bDebugMoveRight = (bits & (1 << kGameInputBit_DebugMoveRight)) != 0;
+	gameInput.bDebugMoveUp = (bits & (1 << kGameInputBit_DebugMoveUp)) != 0;
+	gameInput.bDebugMoveDown = (bits & (1 << kGameInputBit_DebugMoveDown)) != 0;
+#endif
+}
+
+// FNV-1a по размеру поля и цветам клеток
+uint64_t HashField(const Field& field)
+{
+	uint64_t hash = 14695981039346656037ull;
+	const uint32_t header[2] = { field.width, field.height };
+	for (unsigned int i = 0; i < 2; ++i)
+	{
+		hash ^= header[i];
+		hash *= 1099511628211ull;
+	}
+	for (unsigned int i = 0; i < field.width * field.height; ++i)
+	{
+		hash ^= (uint32_t)field.staticBlocks[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ReplayRecorder::ReplayRecorder()
+	: m_seed(0)
+	, m_autoShiftDelayMs(0)
+	, m_autoRepeatMs(0)
+	, m_numFrames(0)
+	, m_runBits(0)
+	, m_runLength(0)
+	, m_bRecording(false)
+{
+	m_fieldSize = Simulation::GetDefaultFieldSize();
+}
+
+void ReplayRecorder::Begin(unsigned int seed, unsigned int autoShiftDelayMs, unsigned int autoRepeatMs, const FieldSize& fieldSize)
+{
+	m_runs.clear();
+	m_seed = seed;
+	m_autoShiftDelayMs = autoShiftDelayMs;
+	m_autoRepeatMs = autoRepeatMs;
+	m_fieldSize = fieldSize;
+	m_numFrames = 0;
+	m_runBits = 0;
+	m_runLength = 0;
+	m_bRecording = true;
+}
+
+void ReplayRecorder::AddFrame(const GameInput& gameInput)
+{
+	if (!m_bRecording)
+		return;
+
+	const uint16_t bits = PackGameInput(gameInput);
+	if (m_runLength > 0 && bits != m_runBits)
+	{
+		FlushRun();
+	}
+	m_runBits = bits;
+	++m_runLength;
+	++m_numFrames;
+}
+
+void ReplayRecorder::FlushRun()
+{
+	m_runs.push_back((uint8_t)m_runBits);
+	m_runs.push_back((uint8_t)(m_runBits >> 8));
+	WriteVarint(m_runs, m_runLength);
+	m_runLength = 0;
+}
+
+bool ReplayRecorder::Save(const char* path)
+{
+	if (!m_bRecording)
+		return false;
+
+	if (m_runLength > 0)
+	{
+		FlushRun();
+	}
+	m_bRecording = false;
+
+	std::vector<uint8_t> header;
+	header.insert(header.end(), s_kReplayMagic, s_kReplayMagic + 4);
+	WriteUint32(header, s_kReplayVersion);
+	WriteUint32(header, m_seed);
+	WriteUint32(header, m_numFrames);
+	WriteUint32(header, m_autoShiftDelayMs);
+	WriteUint32(header, m_autoRepeatMs);
+	WriteUint32(header, m_fieldSize.width);
+	WriteUint32(header, m_fieldSize.height);
+	WriteUint32(header, m_fieldSize.numHiddenRows);
+
+	FILE* pFile = fopen(path, "wb");
+	if (!pFile)
+	{
+		fprintf(stderr, "Failed to open replay file for writing: %s\n", path);
+		return false;
+	}
+	const bool bWritten = fwrite(header.data(), 1, header.size(), pFile) == header.size()
+		&& fwrite(m_runs.data(), 1, m_runs.size(), pFile) == m_runs.size();
+	fclose(pFile);
+
+	if (!bWritten)
+	{
+		fprintf(stderr, "Failed to write replay file: %s\n", path);
+		return false;
+	}
+	printf("Replay saved: %s (%u frames, %u bytes)\n", path, m_numFrames, (unsigned int)(header.size() + m_runs.size()));
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ReplayPlayer::ReplayPlayer()
+	: m_readPos(0)
+	, m_seed(0)
+	, m_autoShiftDelayMs(Simulation::kDefaultAutoShiftDelayMs)
+	, m_autoRepeatMs(Simulation::kDefaultAutoRepeatMs)
+	, m_numFrames(0)
+	, m_frame(0)
+	, m_runBits(0)
+	, m_runLeft(0)
+{
+	m_fieldSize = Simulation::GetDefaultFieldSize();
+}
+
+bool ReplayPlayer::Load(const char* path)
+{
+	m_data.clear();
+	m_readPos = 0;
+	m_frame = 0;
+	m_runLeft = 0;
+
+	FILE* pFile = fopen(path, "rb");
+	if (!pFile)
+	{
+		fprintf(stderr, "Failed to open replay file: %s\n", path);
+		return false;
+	}
+	uint8_t buffer[4096];
+	size_t numRead;
+	while ((numRead = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+	{
+		m_data.insert(m_data.end(), buffer, buffer + numRead);
+	}
+	fclose(pFile);
+
+	if (m_data.size() < s_kReplayHeaderSizeNoAutoShift || memcmp(m_data.data(), s_kReplayMagic, 4) != 0)
+	{
+		fprintf(stderr, "Not a replay file: %s\n", path);
+		return false;
+	}
+	const uint32_t version = ReadUint32(&m_data[4]);
+	if (version != s_kReplayVersion && version != s_kReplayVersionNoFieldSize && version != s_kReplayVersionNoAutoShift)
+	{
+		fprintf(stderr, "Unsupported replay version %u: %s\n", version, path);
+		return false;
+	}
+	const size_t headerSize = version == s_kReplayVersion ? s_kReplayHeaderSize
+		: version == s_kReplayVersionNoFieldSize ? s_kReplayHeaderSizeNoFieldSize : s_kReplayHeaderSizeNoAutoShift;
+	if (m_data.size() < headerSize)
+	{
+		fprintf(stderr, "Not a replay file: %s\n", path);
+		return false;
+	}
+	m_seed = ReadUint32(&m_data[8]);
+	m_numFrames = ReadUint32(&m_data[12]);
+	m_autoShiftDelayMs = Simulation::kDefaultAutoShiftDelayMs;
+	m_autoRepeatMs = Simulation::kDefaultAutoRepeatMs;
+	if (version != s_kReplayVersionNoAutoShift)
+	{
+		m_autoShiftDelayMs = ReadUint32(&m_data[16]);
+		m_autoRepeatMs = ReadUint32(&m_data[20]);
+	}
+	m_fieldSize = GetLegacyFieldSize();
+	if (version == s_kReplayVersion)
+	{
+		m_fieldSize.width = ReadUint32(&m_data[24]);
+		m_fieldSize.height = ReadUint32(&m_data[28]);
+		m_fieldSize.numHiddenRows = ReadUint32(&m_data[32]);
+		if (!Simulation::IsValidFieldSize(m_fieldSize))
+		{
+			fprintf(stderr, "Invalid field size %ux%u+%u in replay: %s\n", m_fieldSize.width, m_fieldSize.height,
+				m_fieldSize.numHiddenRows, path);
+			return false;
+		}
+	}
+	m_readPos = headerSize;
+	return true;
+}
+
+bool ReplayPlayer::ReadRun()
+{
+	if (m_readPos + 2 > m_data.size())
+		return false;
+
+	m_runBits = (uint16_t)(m_data[m_readPos] | (m_data[m_readPos + 1] << 8));
+	m_readPos += 2;
+
+	uint32_t length = 0;
+	for (unsigned int shift = 0; shift < 32; shift += 7)
+	{
+		if (m_readPos >= m_data.size())
+			return false;
+
+		const uint8_t byte = m_data[m_readPos++];
+		length |= (uint32_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			m_runLeft = length;
+			return length > 0;
+		}
+	}
+	return false;
+}
+
+bool ReplayPlayer::NextFrame(GameInput& gameInput)
+{
+	if (m_frame >= m_numFrames)
+		return false;
+
+	if (m_runLeft == 0 && !ReadRun())
+	{
+		fprintf(stderr, "Replay is truncated at frame %u of %u\n", m_frame, m_numFrames);
+		m_numFrames = m_frame;
+		return false;
+	}
+
+	UnpackGameInput(m_runBits, gameInput);
+	--m_runLeft;
+	++m_frame;
+	return true;
+}
@@ -0,0 +1,104 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    Replay.h
+
+	Запись и воспроизведение партии: зерно + ввод каждого кадра симуляции. Так как правила
+	детерминированы, этого достаточно, чтобы повторить партию без окна
+**/
+//--------------------------------------------------------------------------------------------------
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "Simulation.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Формат файла (все числа little-endian):
+//   "TRPL", uint32 версия, uint32 зерно, uint32 число кадров, uint32 задержка и uint32 период автосдвига в мс
+//   (в версии 1 их нет), uint32 ширина, uint32 видимая высота и uint32 скрытые строки поля (только с версии 3,
+//   более старые записи идут на поле 10x20 без скрытых строк)
+//   далее серии: uint16 биты ввода, varint длина серии (сколько кадров подряд с этим вводом)
+// Почти все кадры без ввода, поэтому серии длинные и лог получается маленьким
+
+// ввод симуляции как набор битов (флаги меню в лог не попадают)
+uint16_t	PackGameInput(const GameInput& gameInput);
+void		UnpackGameInput(uint16_t bits, GameInput& gameInput);
+
+// хэш закреплённых блоков поля: по нему сравнивается итог воспроизведения
+uint64_t	HashField(const Field& field);
+
+//--------------------------------------------------------------------------------------------------
+/**
+	\class   ReplayRecorder
+**/
+//--------------------------------------------------------------------------------------------------
+
+class ReplayRecorder
+{
+public:
+
+	ReplayRecorder();
+
+	void			Begin(unsigned int seed, unsigned int autoShiftDelayMs, unsigned int autoRepeatMs, const FieldSize& fieldSize);
+	void			AddFrame(const GameInput& gameInput);	// после каждого Simulation::Update
+	bool			Save(const char* path);					// дописывает последнюю серию и пишет файл
+
+	bool			IsRecording() const { return m_bRecording; }
+	unsigned int	GetNumFrames() const { return m_numFrames; }
+
+private:
+
+	void			FlushRun();
+
+	std::vector<uint8_t> m_runs;
+	unsigned int	m_seed;
+	unsigned int	m_autoShiftDelayMs;
+	unsigned int	m_autoRepeatMs;
+	FieldSize		m_fieldSize;
+	unsigned int	m_numFrames;
+	uint16_t		m_runBits;
+	unsigned int	m_runLength;
+	bool			m_bRecording;
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+	\class   ReplayPlayer
+**/
+//--------------------------------------------------------------------------------------------------
+
+class ReplayPlayer
+{
+public:
+
+	ReplayPlayer();
+
+	bool			Load(const char* path);
+	bool			NextFrame(GameInput& gameInput);	// false - лог закончился
+
+	unsigned int	GetSeed() const { return m_seed; }
+	unsigned int	GetAutoShiftDelayMs() const { return m_autoShiftDelayMs; }	// для Simulation::SetAutoShift
+	unsigned int	GetAutoRepeatMs() const { return m_autoRepeatMs; }
+	const FieldSize&	GetFieldSize() const { return m_fieldSize; }	// для Simulation::SetFieldSize
+	unsigned int	GetNumFrames() const { return m_numFrames; }
+
+private:
+
+	bool			ReadRun();
+
+	std::vector<uint8_t> m_data;
+	size_t			m_readPos;
+	unsigned int	m_seed;
+	unsigned int	m_autoShiftDelayMs;
+	unsigned int	m_autoRepeatMs;
+	FieldSize		m_fieldSize;
+	unsigned int	m_numFrames;
+	unsigned int	m_frame;
+	uint16_t		m_runBits;
+	unsigned int	m_runLeft;
+};
+
+#endif // REPLAY_H
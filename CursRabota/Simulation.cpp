@@ -0,0 +1,738 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    Simulation.cpp
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "Simulation.h"
+
+#include "Debug.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+static const unsigned int s_kFieldWidth = 10;
+static const unsigned int s_kFieldHeight = 20;
+static const unsigned int s_kNumHiddenRows = 0;	// как в исходной игре; скрытые строки включаются через --hidden-rows
+static const size_t s_kCacheLineSize = 64;
+static const unsigned int s_initialTicksPerFallStep = 48;
+static const int s_deltaTicksPerFallStepPerLevel = 2;
+static const int s_kAutoShiftUnitsPerTick = 1000;	// единиц времени автосдвига в такте, в миллисекунде их kTicksPerSecond
+
+//--------------------------------------------------------------------------------------------------
+
+static constexpr Tetromino s_tetrominos[kNumTetrominoTypes] =
+{
+	// I
+	{
+		0, 1, 1, 1, 2, 1, 3, 1,
+		2, 0, 2, 1, 2, 2, 2, 3,
+		0, 2, 1, 2, 2, 2, 3, 2,
+		1, 0, 1, 1, 1, 2, 1, 3,
+		0x00ffffff,
+	},
+	// J
+	{
+		0, 0, 0, 1, 1, 1, 2, 1,
+		1, 0, 2, 0, 1, 1, 1, 2,
+		0, 1, 1, 1, 2, 1, 2, 2,
+		1, 0, 1, 1, 0, 2, 1, 2,
+		0x0000ffff,
+	},
+	// L
+	{
+		2, 0, 0, 1, 1, 1, 2, 1,
+		1, 0, 1, 1, 1, 2, 2, 2,
+		0, 1, 1, 1, 2, 1, 0, 2,
+		0, 0, 1, 0, 1, 1, 1, 2,
+		0xffaa00ff,
+	},
+	// O
+	{
+		1, 0, 2, 0, 1, 1, 2, 1,
+		1, 0, 2, 0, 1, 1, 2, 1,
+		1, 0, 2, 0, 1, 1, 2, 1,
+		1, 0, 2, 0, 1, 1, 2, 1,
+		0xffff00ff
+	},
+	// S
+	{
+		1, 0, 2, 0, 0, 1, 1, 1,
+		1, 0, 1, 1, 2, 1, 2, 2,
+		1, 1, 2, 1, 0, 2, 1, 2,
+		0, 0, 0, 1, 1, 1, 1, 2,
+		0x00ff00ff,
+	},
+	// T
+	{
+		1, 0, 0, 1, 1, 1, 2, 1,
+		1, 0, 1, 1, 2, 1, 1, 2,
+		0, 1, 1, 1, 2, 1, 1, 2,
+		1, 0, 0, 1, 1, 1, 1, 2,
+		0x9900ffff,
+	},
+	// Z
+	{
+		0, 0, 1, 0, 1, 1, 2, 1,
+		2, 0, 1, 1, 2, 1, 1, 2,
+		0, 1, 1, 1, 1, 2, 2, 2,
+		1, 0, 0, 1, 1, 1, 0, 2,
+		0xff0000ff,
+	}
+};
+
+//--------------------------------------------------------------------------------------------------
+
+// Таблица масок строится компилятором из s_tetrominos, форма фигур задаётся только там
+struct PieceMaskTable
+{
+	PieceMask masks[kNumTetrominoTypes][Tetromino::kNumRotations];
+};
+
+static constexpr PieceMaskTable BuildPieceMasks()
+{
+	PieceMaskTable table = {};
+	for (unsigned int type = 0; type < kNumTetrominoTypes; ++type)
+	{
+		for (unsigned int rotation = 0; rotation < Tetromino::kNumRotations; ++rotation)
+		{
+			PieceMask& mask = table.masks[type][rotation];
+			mask.minX = mask.minY = Tetromino::kNumBlocks;
+			mask.maxX = mask.maxY = -1;
+			for (unsigned int column = 0; column < Tetromino::kNumBlocks; ++column)
+			{
+				mask.columnTop[column] = -1;
+				mask.columnBottom[column] = -1;
+			}
+
+			for (unsigned int i = 0; i < Tetromino::kNumBlocks; ++i)
+			{
+				const int x = (int)s_tetrominos[type].blockCoord[rotation][i].x;
+				const int y = (int)s_tetrominos[type].blockCoord[rotation][i].y;
+				mask.rows[y] |= (FieldRowMask)1 << x;
+				mask.minX = x < mask.minX ? x : mask.minX;
+				mask.maxX = x > mask.maxX ? x : mask.maxX;
+				mask.minY = y < mask.minY ? y : mask.minY;
+				mask.maxY = y > mask.maxY ? y : mask.maxY;
+				if (mask.columnTop[x] < 0 || y < mask.columnTop[x])
+					mask.columnTop[x] = y;
+				if (y > mask.columnBottom[x])
+					mask.columnBottom[x] = y;
+			}
+		}
+	}
+	return table;
+}
+
+static constexpr PieceMaskTable s_pieceMasks = BuildPieceMasks();
+
+static_assert(s_pieceMasks.masks[kTetrominoType_I][0].rows[1] == 0xf, "I piece mask");
+static_assert(s_pieceMasks.masks[kTetrominoType_T][0].columnBottom[1] == 1, "T piece bottom profile");
+static_assert(s_pieceMasks.masks[kTetrominoType_O][0].minX == 1 && s_pieceMasks.masks[kTetrominoType_O][0].maxX == 2, "O piece bounds");
+
+// маска строки фигуры, сдвинутая в столбец x поля (габариты уже проверены)
+static FieldRowMask ShiftRowMask(FieldRowMask rowMask, int x)
+{
+	return x >= 0 ? (FieldRowMask)(rowMask << x) : (FieldRowMask)(rowMask >> -x);
+}
+
+bool Simulation::IsOverlap(const TetrominoInstance& tetronimoInstance, const Field& field)
+{
+	const PieceMask& mask = s_pieceMasks.masks[tetronimoInstance.m_tetrominoType][tetronimoInstance.m_rotation];
+	const int x = tetronimoInstance.m_pos.x;
+	const int y = tetronimoInstance.m_pos.y;
+
+	// Считайте выход за пределы поля перекрытием
+	if ((x + mask.minX < 0) | (x + mask.maxX >= (int)field.width) | (y < 0) | (y + mask.maxY >= (int)field.height))
+		return true;
+
+	// под полем есть запасные строки, поэтому все 4 строки маски читаются без ветвлений
+	const FieldRowMask* rowMasks = &field.rowMasks[y];
+	const FieldRowMask hit = (rowMasks[0] & ShiftRowMask(mask.rows[0], x))
+		| (rowMasks[1] & ShiftRowMask(mask.rows[1], x))
+		| (rowMasks[2] & ShiftRowMask(mask.rows[2], x))
+		| (rowMasks[3] & ShiftRowMask(mask.rows[3], x));
+	return hit != 0;
+}
+
+int Simulation::GetDropDistance(const TetrominoInstance& tetronimoInstance, const Field& field)
+{
+	const PieceMask& mask = s_pieceMasks.masks[tetronimoInstance.m_tetrominoType][tetronimoInstance.m_rotation];
+	const int x = tetronimoInstance.m_pos.x;
+	const int y = tetronimoInstance.m_pos.y;
+
+	// если каждый столбец фигуры выше верхнего блока поля, расстояние считается по нижнему профилю фигуры
+	if ((x + mask.minX >= 0) && (x + mask.maxX < (int)field.width) && (y >= 0) && (y + mask.maxY < (int)field.height))
+	{
+		int distance = (int)field.height;
+		bool bAboveStack = true;
+		for (int column = mask.minX; column <= mask.maxX; ++column)
+		{
+			if (mask.columnBottom[column] < 0)
+				continue;
+
+			const int bottom = y + mask.columnBottom[column];
+			const int gap = field.columnTops[x + column] - bottom - 1;
+			bAboveStack &= (gap >= 0);
+			distance = gap < distance ? gap : distance;
+		}
+		if (bAboveStack)
+			return distance;
+	}
+
+	// фигура под нависающими блоками - опускаем её по одной строке
+	TetrominoInstance testInstance = tetronimoInstance;
+	int distance = -1;
+	while (!IsOverlap(testInstance, field))
+	{
+		++testInstance.m_pos.y;
+		++distance;
+	}
+	return distance;
+}
+
+// пересчёт высот столбцов по маскам строк (после удаления строк)
+static void UpdateColumnTops(Field& field)
+{
+	FieldRowMask foundColumns = 0;
+	for (unsigned int ix = 0; ix < field.width; ++ix)
+	{
+		field.columnTops[ix] = (int)field.height;
+	}
+	for (unsigned int iy = 0; iy < field.height && foundColumns != field.fullRowMask; ++iy)
+	{
+		const FieldRowMask newColumns = field.rowMasks[iy] & ~foundColumns;
+		if (!newColumns)
+			continue;
+
+		for (unsigned int ix = 0; ix < field.width; ++ix)
+		{
+			if (newColumns & ((FieldRowMask)1 << ix))
+				field.columnTops[ix] = (int)iy;
+		}
+		foundColumns |= newColumns;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Simulation::Simulation()
+	: m_pFieldStorage(nullptr)
+	, m_fieldStorageBytes(0)
+	, m_numLeftInBag(0)
+	, m_ticksUntilFall(s_initialTicksPerFallStep)
+	, m_ticksPerFallStep(s_initialTicksPerFallStep)
+	, m_numUserDropsForThisTetronimo(0)
+	, m_autoShiftDelayMs(kDefaultAutoShiftDelayMs)
+	, m_autoRepeatMs(kDefaultAutoRepeatMs)
+	, m_autoShiftDirection(0)
+	, m_autoShiftCharge(0)
+	, m_numLinesCleared(0)
+	, m_level(0)
+	, m_score(0)
+	, m_numTetrominosPlaced(0)
+	, m_bGameOver(false)
+	, m_pAddTimer(nullptr)
+{
+	m_fieldSize = GetDefaultFieldSize();
+	m_field.width = 0;
+	m_field.height = 0;
+	m_field.numHiddenRows = 0;
+	m_field.staticBlocks = nullptr;
+	m_field.rowMasks = nullptr;
+	m_field.columnTops = nullptr;
+	m_field.fullRowMask = 0;
+
+	for (unsigned int i = 0; i < kNumNextTetrominos; ++i)
+	{
+		m_nextTetrominos[i] = kTetrominoType_I;
+	}
+}
+
+Simulation::~Simulation()
+{
+	delete[] m_pFieldStorage;
+	m_pFieldStorage = nullptr;
+	m_field.staticBlocks = nullptr;
+	m_field.rowMasks = nullptr;
+	m_field.columnTops = nullptr;
+}
+
+FieldSize Simulation::GetDefaultFieldSize()
+{
+	FieldSize fieldSize;
+	fieldSize.width = s_kFieldWidth;
+	fieldSize.height = s_kFieldHeight;
+	fieldSize.numHiddenRows = s_kNumHiddenRows;
+	return fieldSize;
+}
+
+bool Simulation::IsValidFieldSize(const FieldSize& fieldSize)
+{
+	return fieldSize.width >= kMinFieldWidth && fieldSize.width <= kMaxFieldWidth
+		&& fieldSize.height >= kMinFieldHeight && fieldSize.height <= kMaxFieldHeight
+		&& fieldSize.numHiddenRows <= kMaxNumHiddenRows;
+}
+
+void Simulation::SetFieldSize(const FieldSize& fieldSize)
+{
+	HP_ASSERT(IsValidFieldSize(fieldSize));
+	m_fieldSize = fieldSize;
+}
+
+static size_t AlignToCacheLine(size_t bytes)
+{
+	return (bytes + s_kCacheLineSize - 1) & ~(s_kCacheLineSize - 1);
+}
+
+// раскладывает массивы поля по общей памяти; память растёт только под большее поле
+void Simulation::AllocateField()
+{
+	const unsigned int width = m_fieldSize.width;
+	const unsigned int height = m_fieldSize.height + m_fieldSize.numHiddenRows;
+	const size_t rowMasksBytes = AlignToCacheLine((height + Field::kNumPaddingRows) * sizeof(FieldRowMask));
+	const size_t columnTopsBytes = AlignToCacheLine(width * sizeof(int));
+	const size_t staticBlocksBytes = AlignToCacheLine(width * height * sizeof(int));
+	const size_t totalBytes = rowMasksBytes + columnTopsBytes + staticBlocksBytes;
+	if (totalBytes > m_fieldStorageBytes)
+	{
+		delete[] m_pFieldStorage;
+		m_pFieldStorage = new unsigned char[totalBytes + s_kCacheLineSize - 1];	// запас на выравнивание начала
+		m_fieldStorageBytes = totalBytes;
+	}
+
+	unsigned char* pStorage = (unsigned char*)AlignToCacheLine((size_t)m_pFieldStorage);
+	m_field.width = width;
+	m_field.height = height;
+	m_field.numHiddenRows = m_fieldSize.numHiddenRows;
+	m_field.rowMasks = (FieldRowMask*)pStorage;
+	m_field.columnTops = (int*)(pStorage + rowMasksBytes);
+	m_field.staticBlocks = (int*)(pStorage + rowMasksBytes + columnTopsBytes);
+	m_field.fullRowMask = width == Field::kMaxWidth ? ~(FieldRowMask)0 : ((FieldRowMask)1 << width) - 1;
+}
+
+const Tetromino& Simulation::GetTetromino(TetrominoType tetrominoType)
+{
+	HP_ASSERT(tetrominoType < kNumTetrominoTypes);
+	return s_tetrominos[tetrominoType];
+}
+
+const PieceMask& Simulation::GetPieceMask(TetrominoType tetrominoType, unsigned int rotation)
+{
+	HP_ASSERT(tetrominoType < kNumTetrominoTypes);
+	HP_ASSERT(rotation < Tetromino::kNumRotations);
+	return s_pieceMasks.masks[tetrominoType][rotation];
+}
+
+TetrominoInstance Simulation::GetSpawnInstance(TetrominoType tetrominoType, const Field& field)
+{
+	TetrominoInstance tetronimoInstance;
+	tetronimoInstance.m_tetrominoType = tetrominoType;
+	tetronimoInstance.m_rotation = 0;
+	tetronimoInstance.m_pos.x = (field.width - 4) / 2;	// ширина блока tetronimo приблизительно = 4
+	// блоки фигуры в начальном повороте занимают две верхние строки рамки: ставим их в две нижние скрытые строки
+	tetronimoInstance.m_pos.y = field.numHiddenRows >= 2 ? (int)field.numHiddenRows - 2 : 0;
+	return tetronimoInstance;
+}
+
+// следующая фигура из мешка, пустой мешок заполняется заново и перемешивается
+TetrominoType Simulation::TakeFromBag()
+{
+	if (m_numLeftInBag == 0)
+	{
+		for (unsigned int i = 0; i < kNumTetrominoTypes; ++i)
+		{
+			m_bag[i] = (TetrominoType)i;
+		}
+		for (unsigned int i = kNumTetrominoTypes - 1; i > 0; --i)
+		{
+			const unsigned int j = m_random.NextBelow(i + 1);
+			const TetrominoType temp = m_bag[i];
+			m_bag[i] = m_bag[j];
+			m_bag[j] = temp;
+		}
+		m_numLeftInBag = kNumTetrominoTypes;
+	}
+	return m_bag[--m_numLeftInBag];
+}
+
+// возвращает true, если есть место для спавна 
+bool Simulation::SpawnTetronimo()
+{
+	m_activeTetromino = GetSpawnInstance(m_nextTetrominos[0], m_field);
+	for (unsigned int i = 1; i < kNumNextTetrominos; ++i)
+	{
+		m_nextTetrominos[i - 1] = m_nextTetrominos[i];
+	}
+	m_nextTetrominos[kNumNextTetrominos - 1] = TakeFromBag();
+
+	if (IsOverlap(m_activeTetromino, m_field))
+	{
+		return false;
+	}
+
+	m_ticksUntilFall = s_initialTicksPerFallStep;
+	m_numUserDropsForThisTetronimo = 0;
+	return true;
+}
+
+void Simulation::NewGame(unsigned int seed)
+{
+	AllocateField();
+
+	// -1 во всех байтах - это -1 в каждой клетке
+	memset(m_field.staticBlocks, 0xff, m_field.width * m_field.height * sizeof(int));
+	memset(m_field.rowMasks, 0, m_field.height * sizeof(FieldRowMask));
+	for (unsigned int iy = m_field.height; iy < m_field.height + Field::kNumPaddingRows; ++iy)
+	{
+		m_field.rowMasks[iy] = m_field.fullRowMask;	// "пол" под полем
+	}
+	for (unsigned int ix = 0; ix < m_field.width; ++ix)
+	{
+		m_field.columnTops[ix] = (int)m_field.height;
+	}
+
+	// новая партия - все строки поля изменились
+	m_rowRevisions.resize(m_field.height);
+	for (unsigned int iy = 0; iy < m_field.height; ++iy)
+	{
+		++m_rowRevisions[iy];
+	}
+
+	m_random.Seed(seed);
+	m_numLeftInBag = 0;
+	for (unsigned int i = 0; i < kNumNextTetrominos; ++i)
+	{
+		m_nextTetrominos[i] = TakeFromBag();
+	}
+
+	m_bGameOver = !SpawnTetronimo(); // создает фигуру в тетрисе (рандомную)
+
+	m_autoShiftDirection = 0;
+	m_autoShiftCharge = 0;
+
+	m_numLinesCleared = 0;
+	m_level = 0;
+	m_ticksPerFallStep = s_initialTicksPerFallStep;
+	m_score = 0;
+	m_numTetrominosPlaced = 0;
+}
+
+
+void Simulation::SetAutoShift(unsigned int delayMs, unsigned int repeatMs)
+{
+	// в единицах автосдвига значения должны помещаться в int
+	m_autoShiftDelayMs = delayMs < kMaxAutoShiftMs ? delayMs : kMaxAutoShiftMs;
+	m_autoRepeatMs = repeatMs < kMaxAutoShiftMs ? repeatMs : kMaxAutoShiftMs;
+}
+
+// false - упёрлись
+bool Simulation::TryShift(int dx)
+{
+	TetrominoInstance testInstance = m_activeTetromino;
+	testInstance.m_pos.x += dx;
+	if (IsOverlap(testInstance, m_field))
+		return false;
+
+	m_activeTetromino.m_pos.x = testInstance.m_pos.x;
+	return true;
+}
+
+void Simulation::UpdateAutoShift(const GameInput& gameInput)
+{
+	// нажатие сдвигает сразу (в Update) и заново запускает задержку; из двух зажатых клавиш главнее нажатая последней
+	const int autoShiftDelay = (int)((int64_t)m_autoShiftDelayMs * kTicksPerSecond);
+	const int autoRepeat = (int)((int64_t)m_autoRepeatMs * kTicksPerSecond);
+	bool bPressed = false;
+	if (gameInput.bMoveLeft)
+	{
+		m_autoShiftDirection = -1;
+		bPressed = true;
+	}
+	if (gameInput.bMoveRight)
+	{
+		m_autoShiftDirection = 1;
+		bPressed = true;
+	}
+
+	// клавишу отпустили - переходим на противоположную, если она ещё зажата
+	const bool bHeld = m_autoShiftDirection < 0 ? gameInput.bHoldLeft : gameInput.bHoldRight;
+	if (m_autoShiftDirection != 0 && !bHeld)
+	{
+		m_autoShiftDirection = gameInput.bHoldLeft ? -1 : (gameInput.bHoldRight ? 1 : 0);
+		bPressed = true;
+	}
+	if (m_autoShiftDirection == 0)
+		return;
+
+	if (bPressed)
+	{
+		// такт нажатия уже сдвинул фигуру, задержка отсчитывается со следующего
+		m_autoShiftCharge = autoShiftDelay;
+		return;
+	}
+
+	m_autoShiftCharge -= s_kAutoShiftUnitsPerTick;
+	while (m_autoShiftCharge <= 0)
+	{
+		if (!TryShift(m_autoShiftDirection))
+		{
+			m_autoShiftCharge = 0;	// стоим у стенки заряженными: как только место освободится, сдвинемся в том же такте
+			break;
+		}
+		m_autoShiftCharge += autoRepeat;	// при autoRepeat == 0 идём до упора
+	}
+}
+
+//метод считывания действий во время игры
+void Simulation::Update(const GameInput& gameInput)
+{
+	if (m_bGameOver)
+		return;
+
+#ifdef _DEBUG
+	if (gameInput.bDebugChangeTetromino)
+	{
+		m_activeTetromino.m_tetrominoType = (TetrominoType)(((unsigned int)m_activeTetromino.m_tetrominoType + 1) % (unsigned int)kNumTetrominoTypes);
+	}
+	if (gameInput.bDebugMoveLeft)
+	{
+		--m_activeTetromino.m_pos.x;
+	}
+	if (gameInput.bDebugMoveRight)
+	{
+		++m_activeTetromino.m_pos.x;
+	}
+	if (gameInput.bDebugMoveUp)
+	{
+		--m_activeTetromino.m_pos.y;
+	}
+	if (gameInput.bDebugMoveDown)
+	{
+		++m_activeTetromino.m_pos.y;
+	}
+#endif
+
+	// двигается горизонтально 
+	if (gameInput.bMoveLeft)
+	{
+		TryShift(-1);
+	}
+	if (gameInput.bMoveRight)
+	{
+		TryShift(1);
+	}
+	UpdateAutoShift(gameInput);
+
+
+	// вращение 
+	if (gameInput.bRotateClockwise)
+	{
+		TetrominoInstance testInstance = m_activeTetromino;
+		if (testInstance.m_rotation == 0)
+		{
+			testInstance.m_rotation = 3;
+		}
+		else
+		{
+			--testInstance.m_rotation;
+		}
+
+		// проверьте наличие перекрытий
+		if (IsOverlap(testInstance, m_field))
+		{
+			// Простой удар по стене, попробуйте 1 влево и 1 вправо
+			testInstance.m_pos.x = m_activeTetromino.m_pos.x - 1;
+			if (!IsOverlap(testInstance, m_field))
+			{
+				m_activeTetromino = testInstance;
+			}
+			else
+			{
+				testInstance.m_pos.x = m_activeTetromino.m_pos.x + 1;
+				if (!IsOverlap(testInstance, m_field))
+				{
+					m_activeTetromino = testInstance;
+				}
+			}
+		}
+		else
+		{
+			// никакого перекрытия
+			m_activeTetromino = testInstance;
+		}
+	}
+
+	if (gameInput.bRotateAnticlockwise)
+	{
+		m_activeTetromino.m_rotation = (m_activeTetromino.m_rotation + 1) % Tetromino::kNumRotations;
+	}
+
+	// падает 
+	m_ticksUntilFall -= 1;
+	if (m_ticksUntilFall <= 0)
+	{
+		m_ticksUntilFall = m_ticksPerFallStep;
+
+		// попробуйте пошевелится 
+		TetrominoInstance testInstance = m_activeTetromino;
+		testInstance.m_pos.y += 1;
+		if (IsOverlap(testInstance, m_field))
+		{
+			LockTetronimo(m_activeTetromino);
+			if (!SpawnTetronimo())
+				m_bGameOver = true;
+		}
+		else
+		{
+			m_activeTetromino.m_pos.y = testInstance.m_pos.y;
+		}
+	}
+
+	if (m_bGameOver)
+		return;
+
+	// мягкое падение (медленное)
+	if (gameInput.bSoftDrop)
+	{
+		// попробуй двигаться 
+		TetrominoInstance testInstance = m_activeTetromino;
+		++testInstance.m_pos.y;
+		if (!IsOverlap(testInstance, m_field))
+		{
+			m_activeTetromino.m_pos.y = testInstance.m_pos.y;
+			++m_numUserDropsForThisTetronimo;
+		}
+	}
+
+	// быстрое падение 
+	if (gameInput.bHardDrop)
+	{
+		TetrominoInstance testInstance = m_activeTetromino;
+		const int dropDistance = GetDropDistance(testInstance, m_field);
+		testInstance.m_pos.y += dropDistance;
+		m_numUserDropsForThisTetronimo += dropDistance;
+		LockTetronimo(testInstance);
+		if (!SpawnTetronimo())
+			m_bGameOver = true;
+	}
+	
+}
+
+void Simulation::LockTetronimo(const TetrominoInstance& tetronimoInstance)
+{
+	if (!m_pAddTimer)
+	{
+		AddTetronimoToField(m_field, tetronimoInstance);
+		return;
+	}
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	AddTetronimoToField(m_field, tetronimoInstance);
+	m_pAddTimer->seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	++m_pAddTimer->numCalls;
+}
+
+void Simulation::AddTetronimoToField(Field& field, const TetrominoInstance& tetronimoInstance)
+{
+	const Tetromino& tetronimo = s_tetrominos[tetronimoInstance.m_tetrominoType];
+	const Tetromino::BlockCoords& blockCoords = tetronimo.blockCoord[tetronimoInstance.m_rotation];
+	for (unsigned int i = 0; i < Tetromino::kNumBlocks; ++i)
+	{
+		const int x = tetronimoInstance.m_pos.x + blockCoords[i].x;
+		const int y = tetronimoInstance.m_pos.y + blockCoords[i].y;
+
+		//  выход за пределы поля -- перекрытие
+		HP_ASSERT((x >= 0) && (x < (int)field.width) && (y >= 0) && (y < (int)field.height))
+
+		field.staticBlocks[x + y * field.width] = (int)tetronimoInstance.m_tetrominoType;
+	}
+	++m_numTetrominosPlaced;
+
+	const PieceMask& mask = s_pieceMasks.masks[tetronimoInstance.m_tetrominoType][tetronimoInstance.m_rotation];
+	for (int row = mask.minY; row <= mask.maxY; ++row)
+	{
+		const unsigned int y = tetronimoInstance.m_pos.y + row;
+		field.rowMasks[y] |= ShiftRowMask(mask.rows[row], tetronimoInstance.m_pos.x);
+		++m_rowRevisions[y];
+	}
+	for (int column = mask.minX; column <= mask.maxX; ++column)
+	{
+		if (mask.columnTop[column] < 0)
+			continue;
+
+		const int x = tetronimoInstance.m_pos.x + column;
+		const int top = tetronimoInstance.m_pos.y + mask.columnTop[column];
+		if (top < field.columnTops[x])
+			field.columnTops[x] = top;
+	}
+
+	// очистите все полные строки - заполниться могли только строки, занятые фигурой
+	unsigned int numLinesCleared = 0;
+	for (int row = mask.minY; row <= mask.maxY; ++row)
+	{
+		const unsigned int y = tetronimoInstance.m_pos.y + row;
+		if (field.rowMasks[y] != field.fullRowMask)
+			continue;
+
+		++numLinesCleared;
+
+		// сдвигаем все строки выше на одну вниз, сверху появляется пустая строка
+		memmove(&field.rowMasks[1], &field.rowMasks[0], y * sizeof(FieldRowMask));
+		memmove(&field.staticBlocks[field.width], &field.staticBlocks[0], y * field.width * sizeof(int));
+		field.rowMasks[0] = 0;
+		for (unsigned int x = 0; x < field.width; ++x)
+		{
+			field.staticBlocks[x] = -1;
+		}
+
+		for (unsigned int yy = 0; yy <= y; ++yy)
+		{
+			++m_rowRevisions[yy];
+		}
+	}
+	if (numLinesCleared > 0)
+	{
+		UpdateColumnTops(field);
+	}
+
+	unsigned int previousLevel = m_numLinesCleared / 10;
+	m_numLinesCleared += numLinesCleared;
+	m_level = m_numLinesCleared / 10;
+
+	if (m_level != previousLevel)
+	{
+		// скорость обновления
+		m_ticksPerFallStep -= s_deltaTicksPerFallStepPerLevel;
+		if (m_ticksPerFallStep < 1)
+		{
+			m_ticksPerFallStep = 1;
+		}
+	}
+
+	// счёт
+	if (numLinesCleared > 0)
+	{
+		unsigned int multiplier = 0;
+		switch (numLinesCleared)
+		{
+		case 1:
+			multiplier = 40;
+			break;
+		case 2:
+			multiplier = 100;
+			break;
+		case 3:
+			multiplier = 300;
+			break;
+		case 4:
+			multiplier = 1200;
+		}
+
+		unsigned int score = multiplier * (previousLevel + 1);
+		score += m_numUserDropsForThisTetronimo;
+		m_score += score;
+	}
+
+}
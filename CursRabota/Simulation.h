@@ -0,0 +1,243 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    Simulation.h
+**/
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+// Правила игры без зависимостей от SDL: можно гонять партии без окна
+
+#include "Random.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// структура для отслеживания позиция точки на экране 
+struct uint2
+{
+	unsigned int x;
+	unsigned int y;
+};
+// структура для отслеживания позиция точки на экране 
+struct int2
+{
+	int x;
+	int y;
+};
+// строка поля как битовая маска: бит x = клетка занята
+typedef uint64_t FieldRowMask;
+
+// размер поля, задаётся до начала партии
+struct FieldSize
+{
+	unsigned int width;
+	unsigned int height;		// видимых строк
+	unsigned int numHiddenRows;	// строк над видимой частью: в них появляются фигуры, на экран они не выводятся
+};
+
+// структура - игровое поле 
+struct Field
+{
+	static const unsigned int kMaxWidth = sizeof(FieldRowMask) * 8;
+	static const unsigned int kNumPaddingRows = 4;	// заполненные строки под полем в rowMasks
+
+	unsigned int width; // высота
+	unsigned int height;// длина (вместе со скрытыми строками)
+	unsigned int numHiddenRows;	// строки 0..numHiddenRows-1 не видны игроку
+	int* staticBlocks;		// -1 = пусто, иначе тип фигуры (для отрисовки)
+	FieldRowMask* rowMasks;	// занятость клеток (height + kNumPaddingRows строк), по ней считаются столкновения и полные строки
+	int* columnTops;		// верхняя занятая строка в каждом столбце, height = столбец пуст
+	FieldRowMask fullRowMask;
+};
+
+struct Tetromino
+{
+	static const unsigned int kNumBlocks = 4;
+	static const unsigned int kNumRotations = 4;
+	typedef uint2 BlockCoords[kNumBlocks];
+
+	BlockCoords blockCoord[kNumRotations];
+	unsigned int rgba;
+};
+
+enum TetrominoType
+{
+	kTetrominoType_I = 0,
+	kTetrominoType_J,
+	kTetrominoType_L,
+	kTetrominoType_O,
+	kTetrominoType_S,
+	kTetrominoType_T,
+	kTetrominoType_Z,
+	kNumTetrominoTypes
+};
+
+// маски строк фигуры в её локальных координатах (бит x = блок в столбце x), габариты и профиль по столбцам
+struct PieceMask
+{
+	FieldRowMask rows[Tetromino::kNumBlocks];
+	int minX;
+	int maxX;
+	int minY;
+	int maxY;
+	int columnTop[Tetromino::kNumBlocks];		// верхний блок в столбце, -1 = столбец пуст
+	int columnBottom[Tetromino::kNumBlocks];	// нижний блок в столбце, -1 = столбец пуст
+};
+
+struct TetrominoInstance
+{
+	TetrominoType m_tetrominoType;
+	int2 m_pos;
+	unsigned int m_rotation;
+};
+// структура, содержащая игровой ввод 
+struct GameInput
+{
+	bool bStart;
+	bool bMoveLeft;
+	bool bMoveRight;
+	bool bRotateClockwise;			
+	bool bRotateAnticlockwise;		
+	bool bHardDrop;
+	bool bSoftDrop;
+	bool bPause; //+
+	bool WatchHighScore; // ДОБАВИЛ +
+	bool Rules; // ДОБАВИЛ +
+	bool bToggleGhost;	// показать/скрыть тень фигуры
+	// клавиша сейчас зажата (состояние, а не нажатие): по ним идёт автосдвиг
+	bool bHoldLeft;
+	bool bHoldRight;
+
+#ifdef _DEBUG
+	bool bDebugChangeTetromino;
+	bool bDebugMoveLeft;
+	bool bDebugMoveRight;
+	bool bDebugMoveUp;
+	bool bDebugMoveDown;
+#endif
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+	\class   Simulation
+**/
+//--------------------------------------------------------------------------------------------------
+
+class Simulation
+{
+public:
+
+	static const unsigned int kNumNextTetrominos = 3;	// длина очереди следующих фигур
+	static const unsigned int kTicksPerSecond = 60;		// симуляция идёт тактами фиксированной длины, скорость падения задана в тактах
+	static const unsigned int kDefaultAutoShiftDelayMs = 167;
+	static const unsigned int kDefaultAutoRepeatMs = 33;
+	static const unsigned int kMaxAutoShiftMs = 10000;	// большие задержка и период автосдвига урезаются до этого значения
+	static const unsigned int kMinFieldWidth = Tetromino::kNumBlocks;
+	static const unsigned int kMaxFieldWidth = Field::kMaxWidth;
+	static const unsigned int kMinFieldHeight = Tetromino::kNumBlocks;
+	static const unsigned int kMaxFieldHeight = 1000;
+	static const unsigned int kMaxNumHiddenRows = Tetromino::kNumBlocks;
+
+	Simulation();
+	~Simulation();
+
+	void			NewGame(unsigned int seed);
+	void			Update(const GameInput& gameInput);	// один такт игры (1 / kTicksPerSecond секунды)
+
+	// Автосдвиг: зажатая клавиша сдвигает фигуру через delayMs после нажатия, дальше раз в repeatMs.
+	// Время считается точнее такта: если repeatMs короче такта, за такт делается несколько сдвигов,
+	// repeatMs == 0 - сразу до упора. Значения больше kMaxAutoShiftMs урезаются. Настройки сохраняются между партиями
+	void			SetAutoShift(unsigned int delayMs, unsigned int repeatMs);
+	unsigned int	GetAutoShiftDelayMs() const { return m_autoShiftDelayMs; }
+	unsigned int	GetAutoRepeatMs() const { return m_autoRepeatMs; }
+
+	// Размер поля применяется со следующей NewGame и тоже сохраняется между партиями.
+	// Память поля выделяется одним куском и переиспользуется, пока новое поле в него помещается
+	void			SetFieldSize(const FieldSize& fieldSize);
+	const FieldSize&	GetFieldSize() const { return m_fieldSize; }
+	static FieldSize	GetDefaultFieldSize();	// 10x20 без скрытых строк
+	static bool		IsValidFieldSize(const FieldSize& fieldSize);
+
+	bool			IsGameOver() const { return m_bGameOver; }
+
+	const Field&				GetField() const { return m_field; }
+	const TetrominoInstance&	GetActiveTetromino() const { return m_activeTetromino; }
+	TetrominoType				GetNextTetromino(unsigned int i) const { return m_nextTetrominos[i]; }
+	// счётчик изменений строки поля: по нему отрисовка понимает, какие строки перерисовать
+	unsigned int	GetRowRevision(unsigned int iy) const { return m_rowRevisions[iy]; }
+
+	unsigned int	GetNumLinesCleared() const { return m_numLinesCleared; }
+	unsigned int	GetLevel() const { return m_level; }
+	unsigned int	GetScore() const { return m_score; }
+	unsigned int	GetNumTetrominosPlaced() const { return m_numTetrominosPlaced; }
+	int				GetTicksPerFallStep() const { return m_ticksPerFallStep; }	// тактов на одну строку падения
+
+	static const Tetromino&	GetTetromino(TetrominoType tetrominoType);
+	static const PieceMask&	GetPieceMask(TetrominoType tetrominoType, unsigned int rotation);
+	static TetrominoInstance	GetSpawnInstance(TetrominoType tetrominoType, const Field& field);	// где появляется новая фигура
+	static bool		IsOverlap(const TetrominoInstance& tetronimoInstance, const Field& field);
+	// на сколько строк фигура опустится при быстром падении (-1, если она уже перекрывает поле)
+	static int		GetDropDistance(const TetrominoInstance& tetronimoInstance, const Field& field);
+
+private:
+
+	friend class SimulationBench;	// замеряет AddTetronimoToField отдельно от остального кадра
+
+	// время AddTetronimoToField внутри настоящих партий, заполняет только Bench
+	struct AddTimer
+	{
+		double				seconds;
+		unsigned long long	numCalls;
+	};
+
+	Simulation(const Simulation&);
+	Simulation& operator=(const Simulation&);
+
+	bool			SpawnTetronimo();
+	bool			TryShift(int dx);
+	void			UpdateAutoShift(const GameInput& gameInput);
+	TetrominoType	TakeFromBag();
+	void			AddTetronimoToField(Field& field, const TetrominoInstance& tetronimoInstance);
+	void			LockTetronimo(const TetrominoInstance& tetronimoInstance);	// закрепить фигуру в поле (с замером для Bench)
+
+	void			AllocateField();
+
+	FieldSize m_fieldSize;
+	Field m_field;
+	unsigned char* m_pFieldStorage;	// маски строк, высоты столбцов и клетки поля, каждый массив с начала строки кэша
+	size_t m_fieldStorageBytes;
+	TetrominoInstance m_activeTetromino;
+	std::vector<unsigned int> m_rowRevisions;
+
+	// фигуры выдаются мешками по 7: в каждом мешке все типы ровно по разу
+	Random m_random;
+	TetrominoType m_bag[kNumTetrominoTypes];
+	unsigned int m_numLeftInBag;
+	TetrominoType m_nextTetrominos[kNumNextTetrominos];
+
+	int m_ticksUntilFall;
+	int m_ticksPerFallStep;	// это изменяется, когда ты переходишь на новый уровень 
+
+	unsigned int m_numUserDropsForThisTetronimo;
+
+	// автосдвиг; время в 1/(kTicksPerSecond * 1000) секунды, чтобы такт и миллисекунда были целыми
+	unsigned int m_autoShiftDelayMs;
+	unsigned int m_autoRepeatMs;
+	int m_autoShiftDirection;	// -1 влево, 1 вправо, 0 - не сдвигаем
+	int m_autoShiftCharge;		// сколько осталось до следующего сдвига, <= 0 - пора сдвигать
+
+	// счёт
+	unsigned int m_numLinesCleared;
+	unsigned int m_level;
+	unsigned int m_score;
+	unsigned int m_numTetrominosPlaced;
+
+	bool m_bGameOver;
+
+	AddTimer* m_pAddTimer;	// nullptr - не замеряем
+};
+
+#endif // SIMULATION_H
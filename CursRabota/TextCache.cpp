@@ -0,0 +1,172 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    TextCache.cpp
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "TextCache.h"
+
+#include "Debug.h"
+#include "GlyphAtlas.h"
+
+#include "SDL.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <iterator>
+
+//--------------------------------------------------------------------------------------------------
+// хелперы
+
+static SDL_Color MakeSDL_Colour(uint32_t rgba)
+{
+	SDL_Color color;
+	color.r = (unsigned char)((rgba >> 24) & 0xff);
+	color.g = (unsigned char)((rgba >> 16) & 0xff);
+	color.b = (unsigned char)((rgba >> 8) & 0xff);
+	color.a = (unsigned char)((rgba >> 0) & 0xff);
+	return color;
+}
+
+// FNV-1a по байтам строки и цвету
+static uint64_t HashText(const char* text, uint32_t rgba)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (const unsigned char* p = (const unsigned char*)text; *p; ++p)
+	{
+		hash ^= *p;
+		hash *= 1099511628211ull;
+	}
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		hash ^= (rgba >> (i * 8)) & 0xff;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TextCache::TextCache(SDL_Renderer& sdlRenderer, TTF_Font& font, size_t maxBytes)
+	: m_sdlRenderer(sdlRenderer)
+	, m_font(font)
+	, m_frameHits(0)
+	, m_frameMisses(0)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_stats.maxBytes = maxBytes;
+}
+
+TextCache::~TextCache()
+{
+	Clear();
+}
+
+SDL_Texture* TextCache::Get(const char* text, uint32_t rgba, int& width, int& height)
+{
+	SDL_assert(text);
+
+	const uint64_t hash = HashText(text, rgba);
+	auto it = m_lookup.find(hash);
+	if (it != m_lookup.end())
+	{
+		EntryList::iterator entryIt = it->second;
+		if (entryIt->rgba == rgba && entryIt->text == text)
+		{
+			// попадание - переносим запись в начало списка
+			m_entries.splice(m_entries.begin(), m_entries, entryIt);
+			++m_frameHits;
+			++m_stats.totalHits;
+			width = entryIt->width;
+			height = entryIt->height;
+			return entryIt->pTexture;
+		}
+
+		// коллизия хэша - старая запись вытесняется, новая вставляется как при обычном промахе
+		EvictEntry(entryIt);
+	}
+
+	++m_frameMisses;
+	++m_stats.totalMisses;
+
+	m_unicodeText.clear();
+	for (const unsigned char* p = (const unsigned char*)text; *p; ++p)
+	{
+		m_unicodeText.push_back(GlyphAtlas::CodepointFromCp1251(*p));
+	}
+	m_unicodeText.push_back(0);
+
+	SDL_Surface* pSurface = TTF_RenderUNICODE_Blended(&m_font, m_unicodeText.data(), MakeSDL_Colour(rgba));
+	if (!pSurface)
+	{
+		return nullptr;
+	}
+	SDL_Texture* pTexture = SDL_CreateTextureFromSurface(&m_sdlRenderer, pSurface);
+	SDL_FreeSurface(pSurface);
+	if (!pTexture)
+	{
+		fprintf(stderr, "SDL_CreateTextureFromSurface failed: %s\n", SDL_GetError());
+		return nullptr;
+	}
+
+	Entry entry;
+	entry.hash = hash;
+	entry.text = text;
+	entry.rgba = rgba;
+	entry.pTexture = pTexture;
+	SDL_QueryTexture(pTexture, NULL, NULL, &entry.width, &entry.height);
+	entry.bytes = (size_t)entry.width * (size_t)entry.height * 4;
+
+	// освобождаем место, но саму новую запись оставляем даже если она больше лимита
+	while (!m_entries.empty() && m_stats.bytesUsed + entry.bytes > m_stats.maxBytes)
+	{
+		EvictLeastRecentlyUsed();
+	}
+
+	m_entries.push_front(entry);
+	m_lookup[hash] = m_entries.begin();
+	m_stats.bytesUsed += entry.bytes;
+	m_stats.numEntries = (unsigned int)m_entries.size();
+
+	width = entry.width;
+	height = entry.height;
+	return pTexture;
+}
+
+void TextCache::EndFrame()
+{
+	m_stats.frameHits = m_frameHits;
+	m_stats.frameMisses = m_frameMisses;
+	m_frameHits = 0;
+	m_frameMisses = 0;
+}
+
+void TextCache::Clear()
+{
+	for (Entry& entry : m_entries)
+	{
+		SDL_DestroyTexture(entry.pTexture);
+	}
+	m_entries.clear();
+	m_lookup.clear();
+	m_stats.bytesUsed = 0;
+	m_stats.numEntries = 0;
+}
+
+void TextCache::EvictLeastRecentlyUsed()
+{
+	HP_ASSERT(!m_entries.empty());
+
+	EvictEntry(std::prev(m_entries.end()));
+}
+
+void TextCache::EvictEntry(EntryList::iterator entryIt)
+{
+	SDL_DestroyTexture(entryIt->pTexture);
+	m_stats.bytesUsed -= entryIt->bytes;
+	m_lookup.erase(entryIt->hash);
+	m_entries.erase(entryIt);
+
+	++m_stats.totalEvictions;
+	m_stats.numEntries = (unsigned int)m_entries.size();
+}
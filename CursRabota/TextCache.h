@@ -0,0 +1,80 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    TextCache.h
+**/
+//--------------------------------------------------------------------------------------------------
+
+#ifndef TEXT_CACHE_H
+#define TEXT_CACHE_H
+
+#include "SDL_ttf.h"
+
+#include <stdint.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// SDL forward
+struct SDL_Renderer;
+struct SDL_Texture;
+
+// Кэш текстур строк: одна текстура на пару (текст, цвет), вытеснение по LRU при превышении лимита памяти
+class TextCache
+{
+public:
+
+	struct Stats
+	{
+		unsigned int	frameHits;			// попадания за последний кадр
+		unsigned int	frameMisses;		// растеризации TTF за последний кадр
+		unsigned int	totalHits;
+		unsigned int	totalMisses;
+		unsigned int	totalEvictions;
+		unsigned int	numEntries;
+		size_t			bytesUsed;
+		size_t			maxBytes;
+	};
+
+	TextCache(SDL_Renderer& sdlRenderer, TTF_Font& font, size_t maxBytes);
+	~TextCache();
+
+	// Возвращает текстуру строки (создаёт при промахе), nullptr если строку не удалось растеризовать
+	SDL_Texture*	Get(const char* text, uint32_t rgba, int& width, int& height);
+	void			EndFrame();
+	void			Clear();
+
+	const Stats&	GetStats() const { return m_stats; }
+
+private:
+
+	struct Entry
+	{
+		uint64_t		hash;
+		std::string		text;
+		uint32_t		rgba;
+		SDL_Texture*	pTexture;
+		int				width;
+		int				height;
+		size_t			bytes;
+	};
+
+	typedef std::list<Entry> EntryList;
+
+	void			EvictLeastRecentlyUsed();
+	void			EvictEntry(EntryList::iterator entryIt);
+
+	SDL_Renderer&	m_sdlRenderer;
+	TTF_Font&		m_font;
+
+	EntryList		m_entries;		// начало списка - недавно использованные
+	std::unordered_map<uint64_t, EntryList::iterator> m_lookup;
+
+	std::vector<Uint16>	m_unicodeText;	// буфер для перекодировки cp1251 -> юникод
+
+	unsigned int	m_frameHits;
+	unsigned int	m_frameMisses;
+	Stats			m_stats;
+};
+
+#endif // TEXT_CACHE_H
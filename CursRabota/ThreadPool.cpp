@@ -0,0 +1,163 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    ThreadPool.cpp
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "ThreadPool.h"
+
+//--------------------------------------------------------------------------------------------------
+
+unsigned int ThreadPool::GetDefaultNumThreads()
+{
+	const unsigned int numCores = std::thread::hardware_concurrency();
+	return numCores > 0 ? numCores : 1;
+}
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+	: m_numThreads(numThreads > 0 ? numThreads : GetDefaultNumThreads())
+	, m_ranges(new WorkerRange[m_numThreads])
+	, m_pFunction(nullptr)
+	, m_grainSize(1)
+	, m_jobGeneration(0)
+	, m_numBusyWorkers(0)
+	, m_bQuit(false)
+	, m_numSteals(0)
+{
+	for (unsigned int i = 0; i < m_numThreads; ++i)
+	{
+		m_ranges[i].begin = 0;
+		m_ranges[i].end = 0;
+	}
+
+	// поток 0 - вызывающий ParallelFor
+	for (unsigned int i = 1; i < m_numThreads; ++i)
+	{
+		m_threads.push_back(std::thread(&ThreadPool::WorkerMain, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_bQuit = true;
+	}
+	m_jobStarted.notify_all();
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::ParallelFor(uint64_t begin, uint64_t end, uint64_t grainSize, const RangeFunction& function)
+{
+	if (begin >= end)
+		return;
+
+	// на один кусок будить потоки дороже, чем сделать его самому
+	if (m_numThreads == 1 || end - begin <= grainSize)
+	{
+		function(0, begin, end);
+		return;
+	}
+
+	// раздаём диапазон поровну, дальше потоки балансируют его сами
+	const uint64_t count = end - begin;
+	for (unsigned int i = 0; i < m_numThreads; ++i)
+	{
+		std::lock_guard<std::mutex> lock(m_ranges[i].mutex);
+		m_ranges[i].begin = begin + count * i / m_numThreads;
+		m_ranges[i].end = begin + count * (i + 1) / m_numThreads;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_pFunction = &function;
+		m_grainSize = grainSize > 0 ? grainSize : 1;
+		m_numBusyWorkers = m_numThreads - 1;
+		++m_jobGeneration;
+	}
+	m_jobStarted.notify_all();
+
+	RunJob(0);
+
+	std::unique_lock<std::mutex> lock(m_jobMutex);
+	m_jobFinished.wait(lock, [this] { return m_numBusyWorkers == 0; });
+	m_pFunction = nullptr;
+}
+
+void ThreadPool::WorkerMain(unsigned int workerIndex)
+{
+	unsigned int lastJobGeneration = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_jobMutex);
+			m_jobStarted.wait(lock, [this, lastJobGeneration] { return m_bQuit || m_jobGeneration != lastJobGeneration; });
+			if (m_bQuit)
+				return;
+			lastJobGeneration = m_jobGeneration;
+		}
+
+		RunJob(workerIndex);
+
+		{
+			std::lock_guard<std::mutex> lock(m_jobMutex);
+			--m_numBusyWorkers;
+		}
+		m_jobFinished.notify_one();
+	}
+}
+
+void ThreadPool::RunJob(unsigned int workerIndex)
+{
+	uint64_t begin, end;
+	while (TakeLocal(workerIndex, begin, end) || Steal(workerIndex, begin, end))
+	{
+		(*m_pFunction)(workerIndex, begin, end);
+	}
+}
+
+bool ThreadPool::TakeLocal(unsigned int workerIndex, uint64_t& begin, uint64_t& end)
+{
+	WorkerRange& range = m_ranges[workerIndex];
+	std::lock_guard<std::mutex> lock(range.mutex);
+	if (range.begin >= range.end)
+		return false;
+
+	begin = range.begin;
+	end = (range.end - range.begin > m_grainSize) ? range.begin + m_grainSize : range.end;
+	range.begin = end;
+	return true;
+}
+
+bool ThreadPool::Steal(unsigned int workerIndex, uint64_t& begin, uint64_t& end)
+{
+	for (unsigned int i = 1; i < m_numThreads; ++i)
+	{
+		WorkerRange& victim = m_ranges[(workerIndex + i) % m_numThreads];
+		uint64_t stolenBegin, stolenEnd;
+		{
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			const uint64_t remaining = victim.end - victim.begin;
+			if (victim.begin >= victim.end)
+				continue;
+
+			// забираем вторую половину: хозяин продолжает идти с начала своей части
+			stolenBegin = (remaining > m_grainSize) ? victim.begin + remaining / 2 : victim.begin;
+			stolenEnd = victim.end;
+			victim.end = stolenBegin;
+		}
+		m_numSteals.fetch_add(1, std::memory_order_relaxed);
+
+		{
+			WorkerRange& range = m_ranges[workerIndex];
+			std::lock_guard<std::mutex> lock(range.mutex);
+			range.begin = stolenBegin;
+			range.end = stolenEnd;
+		}
+		return TakeLocal(workerIndex, begin, end);
+	}
+	return false;
+}
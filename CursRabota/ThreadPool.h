@@ -0,0 +1,75 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    ThreadPool.h
+**/
+//--------------------------------------------------------------------------------------------------
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков для параллельного цикла по диапазону индексов с кражей работы.
+// Диапазон делится поровну между потоками; поток берёт из своей части кусками по grainSize,
+// а закончив, забирает половину оставшегося у соседа. Вызывающий поток работает как поток 0
+class ThreadPool
+{
+public:
+
+	// workerIndex - номер потока [0, GetNumThreads()), по нему удобно выбирать своё состояние без блокировок
+	typedef std::function<void(unsigned int workerIndex, uint64_t begin, uint64_t end)> RangeFunction;
+
+	explicit ThreadPool(unsigned int numThreads = 0);	// 0 - по числу ядер
+	~ThreadPool();
+
+	unsigned int	GetNumThreads() const { return m_numThreads; }
+	uint64_t		GetNumSteals() const { return m_numSteals.load(std::memory_order_relaxed); }
+
+	// возвращается, когда обработан весь диапазон; вызывать только из одного потока
+	void			ParallelFor(uint64_t begin, uint64_t end, uint64_t grainSize, const RangeFunction& function);
+
+	static unsigned int	GetDefaultNumThreads();
+
+private:
+
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+	// оставшаяся часть диапазона потока; заполнитель отодвигает соседние записи на другую строку кэша
+	struct WorkerRange
+	{
+		std::mutex	mutex;
+		uint64_t	begin;
+		uint64_t	end;
+		char		padding[64];
+	};
+
+	void			WorkerMain(unsigned int workerIndex);
+	void			RunJob(unsigned int workerIndex);
+	bool			TakeLocal(unsigned int workerIndex, uint64_t& begin, uint64_t& end);
+	bool			Steal(unsigned int workerIndex, uint64_t& begin, uint64_t& end);
+
+	unsigned int	m_numThreads;
+	std::vector<std::thread>		m_threads;
+	std::unique_ptr<WorkerRange[]>	m_ranges;
+
+	std::mutex		m_jobMutex;
+	std::condition_variable	m_jobStarted;
+	std::condition_variable	m_jobFinished;
+	const RangeFunction*	m_pFunction;
+	uint64_t		m_grainSize;
+	unsigned int	m_jobGeneration;
+	unsigned int	m_numBusyWorkers;
+	bool			m_bQuit;
+
+	std::atomic<uint64_t>	m_numSteals;
+};
+
+#endif // THREAD_POOL_H
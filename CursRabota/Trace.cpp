@@ -0,0 +1,160 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    Trace.cpp
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "Trace.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+static const unsigned int s_kEventsPerChunk = 16 * 1024;
+static const unsigned int s_kMaxChunksPerThread = 256;	// ~4М событий на поток, дальше события отбрасываются
+
+struct TraceEvent
+{
+	uint64_t		timestampNs;
+	const char*		name;
+	char			phase;		// 'B' - начало, 'E' - конец
+};
+
+// буфер одного потока: память выделяется кусками, уже записанные события не двигаются
+struct TraceThreadBuffer
+{
+	std::vector<TraceEvent*>	chunks;
+	unsigned int	numInLastChunk;
+	unsigned int	threadId;
+	const char*		threadName;
+	uint64_t		numDropped;
+};
+
+typedef std::chrono::steady_clock TraceClock;
+static const TraceClock::time_point s_traceStartTime = TraceClock::now();
+
+// буферы живут до конца процесса: поток мог завершиться раньше, чем трасса записана
+static std::mutex s_threadBuffersMutex;
+static std::vector<TraceThreadBuffer*> s_threadBuffers;
+static thread_local TraceThreadBuffer* t_pThreadBuffer = nullptr;
+
+//--------------------------------------------------------------------------------------------------
+// хелперы
+
+static TraceThreadBuffer& GetThreadBuffer()
+{
+	if (!t_pThreadBuffer)
+	{
+		TraceThreadBuffer* pBuffer = new TraceThreadBuffer();
+		pBuffer->numInLastChunk = s_kEventsPerChunk;
+		pBuffer->threadName = nullptr;
+		pBuffer->numDropped = 0;
+
+		std::lock_guard<std::mutex> lock(s_threadBuffersMutex);
+		pBuffer->threadId = (unsigned int)s_threadBuffers.size() + 1;
+		s_threadBuffers.push_back(pBuffer);
+		t_pThreadBuffer = pBuffer;
+	}
+	return *t_pThreadBuffer;
+}
+
+static void AddEvent(const char* name, char phase)
+{
+	const uint64_t timestampNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(TraceClock::now() - s_traceStartTime).count();
+
+	TraceThreadBuffer& buffer = GetThreadBuffer();
+	if (buffer.numInLastChunk == s_kEventsPerChunk)
+	{
+		if (buffer.chunks.size() >= s_kMaxChunksPerThread)
+		{
+			++buffer.numDropped;
+			return;
+		}
+		buffer.chunks.push_back(new TraceEvent[s_kEventsPerChunk]);
+		buffer.numInLastChunk = 0;
+	}
+
+	TraceEvent& event = buffer.chunks.back()[buffer.numInLastChunk++];
+	event.timestampNs = timestampNs;
+	event.name = name;
+	event.phase = phase;
+}
+
+// имена - литералы из кода, но кавычки и обратные слэши всё равно экранируем
+static void WriteJsonString(FILE* pFile, const char* text)
+{
+	fputc('"', pFile);
+	for (const char* p = text; *p; ++p)
+	{
+		if (*p == '"' || *p == '\\')
+			fputc('\\', pFile);
+		fputc(*p, pFile);
+	}
+	fputc('"', pFile);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Trace::Begin(const char* name)
+{
+	AddEvent(name, 'B');
+}
+
+void Trace::End()
+{
+	AddEvent("", 'E');
+}
+
+void Trace::SetThreadName(const char* name)
+{
+	GetThreadBuffer().threadName = name;
+}
+
+bool Trace::WriteJson(const char* path)
+{
+	FILE* pFile = fopen(path, "w");
+	if (!pFile)
+	{
+		fprintf(stderr, "Failed to open trace file for writing: %s\n", path);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(s_threadBuffersMutex);
+
+	unsigned long long numEvents = 0;
+	unsigned long long numDropped = 0;
+	bool bFirst = true;
+	fprintf(pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (const TraceThreadBuffer* pBuffer : s_threadBuffers)
+	{
+		if (pBuffer->threadName)
+		{
+			fprintf(pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", bFirst ? "" : ",\n", pBuffer->threadId);
+			WriteJsonString(pFile, pBuffer->threadName);
+			fprintf(pFile, "}}");
+			bFirst = false;
+		}
+
+		for (size_t chunk = 0; chunk < pBuffer->chunks.size(); ++chunk)
+		{
+			const unsigned int numInChunk = (chunk + 1 == pBuffer->chunks.size()) ? pBuffer->numInLastChunk : s_kEventsPerChunk;
+			for (unsigned int i = 0; i < numInChunk; ++i)
+			{
+				const TraceEvent& event = pBuffer->chunks[chunk][i];
+				fprintf(pFile, "%s{\"name\":", bFirst ? "" : ",\n");
+				WriteJsonString(pFile, event.name);
+				fprintf(pFile, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}", event.phase, event.timestampNs / 1000.0, pBuffer->threadId);
+				bFirst = false;
+			}
+			numEvents += numInChunk;
+		}
+		numDropped += pBuffer->numDropped;
+	}
+	fprintf(pFile, "\n]}\n");
+	fclose(pFile);
+
+	printf("Trace written: %s (%llu events, %llu dropped)\n", path, numEvents, numDropped);
+	return true;
+}
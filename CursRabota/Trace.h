@@ -0,0 +1,40 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    Trace.h
+
+	Запись событий начала/конца участков кода в буферы потоков и выгрузка в формате Chrome trace_event.
+	Напрямую не используется - только через макросы HP_TRACE_* из Debug.h
+**/
+//--------------------------------------------------------------------------------------------------
+
+#ifndef TRACE_H
+#define TRACE_H
+
+// Каждый поток пишет только в свой буфер, без блокировок; мьютекс берётся один раз, когда поток
+// впервые что-то записывает. Имена должны быть строковыми литералами - сохраняется только указатель
+class Trace
+{
+public:
+
+	static void		Begin(const char* name);
+	static void		End();
+	static void		SetThreadName(const char* name);
+
+	// вызывать, когда остальные потоки уже остановлены
+	static bool		WriteJson(const char* path);
+};
+
+class TraceScope
+{
+public:
+
+	explicit TraceScope(const char* name) { Trace::Begin(name); }
+	~TraceScope() { Trace::End(); }
+
+private:
+
+	TraceScope(const TraceScope&);
+	TraceScope& operator=(const TraceScope&);
+};
+
+#endif // TRACE_H
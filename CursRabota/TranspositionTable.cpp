@@ -0,0 +1,149 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    TranspositionTable.cpp
+**/
+//--------------------------------------------------------------------------------------------------
+
+#include "TranspositionTable.h"
+
+#include <string.h>
+
+//--------------------------------------------------------------------------------------------------
+// хелперы
+
+// data: биты 0..31 - оценка, 32..39 - столбец + 128, 40..41 - поворот, 56..63 - возраст
+static uint64_t PackData(float score, unsigned int rotation, int x, uint8_t age)
+{
+	uint32_t scoreBits;
+	memcpy(&scoreBits, &score, sizeof(scoreBits));
+	return (uint64_t)scoreBits | ((uint64_t)(uint8_t)(x + 128) << 32) | ((uint64_t)(rotation & 3) << 40) | ((uint64_t)age << 56);
+}
+
+static void UnpackData(uint64_t data, float& score, unsigned int& rotation, int& x)
+{
+	const uint32_t scoreBits = (uint32_t)data;
+	memcpy(&score, &scoreBits, sizeof(score));
+	x = (int)((data >> 32) & 0xff) - 128;
+	rotation = (unsigned int)((data >> 40) & 3);
+}
+
+static uint8_t GetDataAge(uint64_t data)
+{
+	return (uint8_t)(data >> 56);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TranspositionTable::TranspositionTable()
+	: m_numBuckets(0)
+	, m_age(0)
+	, m_numProbes(0)
+	, m_numHits(0)
+	, m_numStores(0)
+	, m_numReplacements(0)
+{
+}
+
+void TranspositionTable::Resize(size_t maxBytes)
+{
+	// наибольшая степень двойки корзин, которая помещается в maxBytes
+	const size_t bucketBytes = kEntriesPerBucket * sizeof(Entry);
+	size_t numBuckets = 0;
+	if (maxBytes >= bucketBytes)
+	{
+		numBuckets = 1;
+		while (numBuckets * 2 * bucketBytes <= maxBytes)
+		{
+			numBuckets *= 2;
+		}
+	}
+
+	m_numBuckets = numBuckets;
+	m_entries.reset(numBuckets > 0 ? new Entry[numBuckets * kEntriesPerBucket] : nullptr);
+	for (size_t i = 0; i < numBuckets * kEntriesPerBucket; ++i)
+	{
+		m_entries[i].keyXorData.store(0, std::memory_order_relaxed);
+		m_entries[i].data.store(0, std::memory_order_relaxed);
+	}
+}
+
+bool TranspositionTable::Probe(uint64_t key, float& score, unsigned int& rotation, int& x)
+{
+	if (m_numBuckets == 0)
+		return false;
+
+	m_numProbes.fetch_add(1, std::memory_order_relaxed);
+	Entry* bucket = &m_entries[(key & (m_numBuckets - 1)) * kEntriesPerBucket];
+	for (unsigned int i = 0; i < kEntriesPerBucket; ++i)
+	{
+		const uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+		const uint64_t keyXorData = bucket[i].keyXorData.load(std::memory_order_relaxed);
+		if ((keyXorData ^ data) == key)
+		{
+			UnpackData(data, score, rotation, x);
+			m_numHits.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+void TranspositionTable::Store(uint64_t key, float score, unsigned int rotation, int x)
+{
+	if (m_numBuckets == 0)
+		return;
+
+	m_numStores.fetch_add(1, std::memory_order_relaxed);
+	const uint64_t newData = PackData(score, rotation, x, m_age);
+	Entry* bucket = &m_entries[(key & (m_numBuckets - 1)) * kEntriesPerBucket];
+
+	// та же позиция или свободная запись, иначе запись самого старого перебора
+	Entry* pVictim = &bucket[0];
+	unsigned int victimAge = 0;
+	bool bVictimFree = false;
+	for (unsigned int i = 0; i < kEntriesPerBucket; ++i)
+	{
+		const uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+		const uint64_t keyXorData = bucket[i].keyXorData.load(std::memory_order_relaxed);
+		if ((keyXorData ^ data) == key)
+		{
+			pVictim = &bucket[i];
+			bVictimFree = true;
+			break;
+		}
+
+		const bool bEmpty = (data == 0 && keyXorData == 0);
+		const unsigned int age = (uint8_t)(m_age - GetDataAge(data));
+		if (bEmpty)
+		{
+			if (!bVictimFree)
+			{
+				pVictim = &bucket[i];
+				bVictimFree = true;
+			}
+		}
+		else if (!bVictimFree && age > victimAge)
+		{
+			pVictim = &bucket[i];
+			victimAge = age;
+		}
+	}
+
+	if (!bVictimFree)
+	{
+		m_numReplacements.fetch_add(1, std::memory_order_relaxed);
+	}
+	pVictim->data.store(newData, std::memory_order_relaxed);
+	pVictim->keyXorData.store(key ^ newData, std::memory_order_relaxed);
+}
+
+TranspositionTable::Stats TranspositionTable::GetStats() const
+{
+	Stats stats;
+	stats.numProbes = m_numProbes.load(std::memory_order_relaxed);
+	stats.numHits = m_numHits.load(std::memory_order_relaxed);
+	stats.numStores = m_numStores.load(std::memory_order_relaxed);
+	stats.numReplacements = m_numReplacements.load(std::memory_order_relaxed);
+	stats.memoryBytes = m_numBuckets * kEntriesPerBucket * sizeof(Entry);
+	return stats;
+}
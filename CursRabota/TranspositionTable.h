@@ -0,0 +1,66 @@
+//--------------------------------------------------------------------------------------------------
+/**
+	\file    TranspositionTable.h
+**/
+//--------------------------------------------------------------------------------------------------
+
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+
+// Таблица уже оценённых позиций для перебора автоигрока: ключ - хэш поля и фигуры, значение - оценка
+// лучшего хода и сам ход. Размер фиксирован, записи без блокировок: ключ хранится как key ^ data,
+// поэтому запись, разорванная одновременной записью из другого потока, просто не совпадёт при чтении.
+// При нехватке места вытесняется запись самого старого перебора
+class TranspositionTable
+{
+public:
+
+	struct Stats
+	{
+		unsigned long long	numProbes;
+		unsigned long long	numHits;
+		unsigned long long	numStores;
+		unsigned long long	numReplacements;	// вытеснена запись с другим ключом
+		size_t				memoryBytes;
+	};
+
+	TranspositionTable();
+
+	void			Resize(size_t maxBytes);	// 0 - таблица выключена
+	bool			IsEnabled() const { return m_numBuckets > 0; }
+	void			NewSearch() { ++m_age; }	// записи прошлых переборов вытесняются первыми
+
+	bool			Probe(uint64_t key, float& score, unsigned int& rotation, int& x);
+	void			Store(uint64_t key, float score, unsigned int rotation, int x);
+
+	Stats			GetStats() const;
+
+private:
+
+	TranspositionTable(const TranspositionTable&);
+	TranspositionTable& operator=(const TranspositionTable&);
+
+	static const unsigned int kEntriesPerBucket = 4;	// 4 * 16 байт - примерно строка кэша
+
+	struct Entry
+	{
+		std::atomic<uint64_t>	keyXorData;
+		std::atomic<uint64_t>	data;
+	};
+
+	std::unique_ptr<Entry[]>	m_entries;
+	size_t			m_numBuckets;	// степень двойки
+	uint8_t			m_age;
+
+	std::atomic<unsigned long long>	m_numProbes;
+	std::atomic<unsigned long long>	m_numHits;
+	std::atomic<unsigned long long>	m_numStores;
+	std::atomic<unsigned long long>	m_numReplacements;
+};
+
+#endif // TRANSPOSITION_TABLE_H